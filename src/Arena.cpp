@@ -0,0 +1,88 @@
+#include "Arena.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if AETHER_HUGE_PAGES
+#include <sys/mman.h>
+#endif
+
+namespace aether
+{
+
+namespace
+{
+#if AETHER_HUGE_PAGES
+// transparent huge pages only back whole, aligned 2MB ranges
+constexpr size_t kHugePageSize = size_t{2} << 20;
+#endif
+
+void *allocateAligned(size_t alignment, size_t size)
+{
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    // std::aligned_alloc is missing from macOS before 10.15
+    void *data = nullptr;
+    return posix_memalign(&data, alignment, size) == 0 ? data : nullptr;
+#endif
+}
+
+void freeAligned(void *data)
+{
+#ifdef _WIN32
+    _aligned_free(data);
+#else
+    std::free(data);
+#endif
+}
+} // namespace
+
+void Arena::prepare(size_t size)
+{
+    if (size > capacity_) {
+        release();
+
+#if AETHER_HUGE_PAGES
+        constexpr auto kBlockAlignment = kHugePageSize;
+#else
+        constexpr auto kBlockAlignment = kAlignment;
+#endif
+        const auto capacity =
+            (size + kBlockAlignment - 1) & ~(kBlockAlignment - 1);
+        data_ = static_cast<std::byte *>(
+            allocateAligned(kBlockAlignment, capacity));
+        if (data_ == nullptr) throw std::bad_alloc();
+        capacity_ = capacity;
+
+#if AETHER_HUGE_PAGES
+        hugePages_ = madvise(data_, capacity_, MADV_HUGEPAGE) == 0;
+#endif
+    }
+
+    if (data_ != nullptr) std::memset(data_, 0, capacity_);
+    used_ = 0;
+}
+
+void Arena::release()
+{
+    if (data_ != nullptr) freeAligned(data_);
+    data_      = nullptr;
+    capacity_  = 0;
+    used_      = 0;
+    hugePages_ = false;
+}
+
+float *Arena::take(size_t count)
+{
+    const auto size = getSize(count);
+    assert(used_ + size <= capacity_ || size == 0);
+
+    auto *block = reinterpret_cast<float *>(data_ + used_);
+    used_ += size;
+    return block;
+}
+
+} // namespace aether
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+
+namespace aether
+{
+
+/** Single cache line aligned allocation the buffers of an instance are carved
+    from, so that they sit next to each other in memory. The footprint is
+    summed up front with getSize(), prepare() allocates it once and take()
+    hands out consecutive blocks in the order they were counted.
+ */
+class Arena
+{
+  public:
+    static constexpr size_t kAlignment = 64;
+
+    Arena() = default;
+    Arena(const Arena &)            = delete;
+    Arena &operator=(const Arena &) = delete;
+    ~Arena() { release(); }
+
+    /** Bytes taken in the arena by count floats. */
+    static constexpr size_t getSize(size_t count)
+    {
+        return (count * sizeof(float) + kAlignment - 1) & ~(kAlignment - 1);
+    }
+
+    /** Makes room for size bytes and clears them. The allocation is kept when
+        it is large enough, every block taken before is handed out again. */
+    void prepare(size_t size);
+    void release();
+
+    /** Next count floats of the arena, aligned to kAlignment. */
+    float *take(size_t count);
+
+    [[nodiscard]] size_t getCapacity() const { return capacity_; }
+    [[nodiscard]] bool usesHugePages() const { return hugePages_; }
+
+  private:
+    std::byte *data_{nullptr};
+    size_t capacity_{0};
+    size_t used_{0};
+    bool hugePages_{false};
+};
+
+} // namespace aether
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+
+namespace aether
+{
+
+/** Ring buffer positions over a storage of size samples followed by a copy
+    of its first guard samples. Writes keep the copy up to date so that reads
+    of up to guard samples are contiguous from any position, without wrapping
+    in the inner loops.
+ */
+class MirroredRing
+{
+  public:
+    void prepare(int size, int guard)
+    {
+        assert(guard <= size);
+        size_  = size;
+        guard_ = guard;
+        reset();
+    }
+
+    void reset() { pos_ = 0; }
+
+    // samples of storage per channel
+    [[nodiscard]] int getStorageSize() const { return size_ + guard_; }
+
+    /** Writes count samples at the write position of one channel. */
+    void write(float *ring, const float *in, int count) const
+    {
+        assert(count <= size_);
+        const auto first = std::min(count, size_ - pos_);
+        std::copy(in, in + first, ring + pos_);
+        std::copy(in + first, in + count, ring);
+
+        // mirror what was written to the head of the ring
+        if (pos_ < guard_) {
+            const auto end = std::min(pos_ + first, guard_);
+            std::copy(ring + pos_, ring + end, ring + size_ + pos_);
+        }
+        if (first < count) {
+            const auto end = std::min(count - first, guard_);
+            std::copy(ring, ring + end, ring + size_);
+        }
+    }
+
+    /** Moves the write position once all the channels are written. */
+    void advance(int count) { pos_ = (pos_ + count) % size_; }
+
+    /** Start of guard contiguous samples, delay samples behind the write
+        position. */
+    const float *read(const float *ring, int delay) const
+    {
+        assert(delay <= size_);
+        return ring + (pos_ - delay + size_) % size_;
+    }
+
+  private:
+    int size_{1};
+    int guard_{0};
+    int pos_{0};
+};
+
+} // namespace aether
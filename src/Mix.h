@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace aether
+{
+
+/** Gain ramping linearly over the next processed range. Like the dsp
+    setters, set() must be followed by exactly one range of the same length.
+ */
+class LinearRamp
+{
+  public:
+    void set(float target, int count)
+    {
+        target_ = target;
+        step_   = (target_ - value_) / static_cast<float>(count);
+    }
+
+    void reset(float value)
+    {
+        value_ = target_ = value;
+        step_            = 0.f;
+    }
+
+    /** Returns the gain at the start of the range and its per sample step,
+        then moves to the target. */
+    std::pair<float, float> advance()
+    {
+        auto ramp = std::make_pair(value_, step_);
+        value_    = target_;
+        step_     = 0.f;
+        return ramp;
+    }
+
+  private:
+    float value_{};
+    float target_{};
+    float step_{};
+};
+
+/** out = a + g * (b - a) with g starting at gain and moving by step each
+    sample, out may alias a or b. */
+inline void crossfade(float *out, const float *a, const float *b, float gain,
+                      float step, int count)
+{
+#pragma omp simd
+    for (int i = 0; i < count; ++i) {
+        auto g = gain + step * static_cast<float>(i);
+        out[i] = a[i] + g * (b[i] - a[i]);
+    }
+}
+
+/** out = dry + ga * (a - dry) + gb * (b - dry), the two wet signals of a
+    parallel chain share the same dry path. out may alias any input. */
+inline void mixParallel(float *out, const float *dry, const float *a,
+                        float gainA, float stepA, const float *b, float gainB,
+                        float stepB, int count)
+{
+#pragma omp simd
+    for (int i = 0; i < count; ++i) {
+        auto ga = gainA + stepA * static_cast<float>(i);
+        auto gb = gainB + stepB * static_cast<float>(i);
+        out[i]  = dry[i] + ga * (a[i] - dry[i]) + gb * (b[i] - dry[i]);
+    }
+}
+
+/** Gain of a section fading in or out, starting at gain and moving by step
+    each sample, clamped to [0, 1]. */
+inline float fadeGain(float gain, float step, int i)
+{
+    return std::min(1.f, std::max(0.f, gain + step * static_cast<float>(i)));
+}
+
+/** out = in * g with g the clamped fade gain, out may alias in. */
+inline void applyFade(float *out, const float *in, float gain, float step,
+                      int count)
+{
+#pragma omp simd
+    for (int i = 0; i < count; ++i) {
+        out[i] = in[i] * fadeGain(gain, step, i);
+    }
+}
+
+/** out = wet + (1 - g) * dry with g the clamped fade gain of the section,
+    the dry signal the section no longer receives bypasses it. out may alias
+    wet. */
+inline void addBypassed(float *out, const float *wet, const float *dry,
+                        float gain, float step, int count)
+{
+#pragma omp simd
+    for (int i = 0; i < count; ++i) {
+        out[i] = wet[i] + (1.f - fadeGain(gain, step, i)) * dry[i];
+    }
+}
+
+/** Schroeder allpass over a short delay. Flat in magnitude, it smears the
+    phase so that its output is decorrelated from its input. */
+class Allpass
+{
+  public:
+    void prepare(int delay)
+    {
+        buffer_.assign(static_cast<size_t>(std::max(delay, 1)), 0.f);
+        pos_ = 0;
+    }
+
+    /** out may alias in. */
+    void process(float *out, const float *in, int count)
+    {
+        const auto size = static_cast<int>(buffer_.size());
+        for (int i = 0; i < count; ++i) {
+            auto &slot   = buffer_[static_cast<size_t>(pos_)];
+            auto delayed = slot;
+            slot         = in[i] + kGain * delayed;
+            out[i]       = delayed - kGain * slot;
+            if (++pos_ == size) pos_ = 0;
+        }
+    }
+
+  private:
+    static constexpr float kGain = 0.5f;
+    std::vector<float> buffer_;
+    int pos_{0};
+};
+
+} // namespace aether
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace aether
+{
+
+/** Fixed size mailbox holding the last value posted for each parameter.
+    Posting never allocates nor blocks and may happen from any thread, a
+    single reader collects the slots that changed since its last visit.
+    When a slot is posted again before being collected, the latest value wins.
+ */
+template <size_t N> class ParamMailbox
+{
+    static_assert(N <= 64, "dirty bits are stored in a single 64 bits word");
+
+  public:
+    ParamMailbox() = default;
+
+    bool post(size_t id, float value, int offset = 0) noexcept
+    {
+        if (id >= N) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        auto &slot = slots_[id];
+        slot.value.store(value, std::memory_order_relaxed);
+        slot.offset.store(offset, std::memory_order_relaxed);
+
+        const auto bit = uint64_t{1} << id;
+        if (dirty_.fetch_or(bit, std::memory_order_release) & bit) {
+            coalesced_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    /** Calls fn(id, value, offset) for every slot posted since the last call,
+        in ascending id order. Must only be called from one thread. */
+    template <typename Fn> void collect(Fn &&fn) noexcept
+    {
+        auto dirty = dirty_.exchange(0, std::memory_order_acquire);
+        for (size_t id = 0; dirty != 0; ++id, dirty >>= 1) {
+            if (dirty & 1) {
+                auto &slot = slots_[id];
+                fn(id, slot.value.load(std::memory_order_relaxed),
+                   slot.offset.load(std::memory_order_relaxed));
+            }
+        }
+    }
+
+    [[nodiscard]] uint64_t getCoalescedCount() const noexcept
+    {
+        return coalesced_.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] uint64_t getDroppedCount() const noexcept
+    {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct Slot {
+        std::atomic<float> value{};
+        std::atomic<int> offset{};
+    };
+
+    std::array<Slot, N> slots_;
+    std::atomic<uint64_t> dirty_{0};
+
+    // posts merged into a slot that was not collected yet
+    std::atomic<uint64_t> coalesced_{0};
+    // posts rejected because of an unknown id
+    std::atomic<uint64_t> dropped_{0};
+
+    static_assert(std::atomic<float>::is_always_lock_free);
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+};
+
+} // namespace aether
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace aether
+{
+
+/** Realtime thread running one job at a time on behalf of the audio thread.
+    The audio thread starts a job with kick() and joins it with wait(), the
+    data handed to the job must not be touched in between. Jobs are counted
+    as they are kicked and completed, a wake up without a kick runs nothing.
+ */
+class PipelineWorker : private juce::Thread
+{
+  public:
+    explicit PipelineWorker(std::function<void()> job) :
+        juce::Thread("Aether pipeline"), job_(std::move(job))
+    {
+    }
+    ~PipelineWorker() override { stop(); }
+
+    bool start()
+    {
+        if (isThreadRunning()) return true;
+        start_.reset();
+        return startRealtimeThread(juce::Thread::RealtimeOptions{});
+    }
+
+    void stop()
+    {
+        if (!isThreadRunning()) return;
+        signalThreadShouldExit();
+        start_.signal();
+        stopThread(1000);
+    }
+
+    [[nodiscard]] bool isRunning() const { return isThreadRunning(); }
+
+    void kick()
+    {
+        kicked_.store(kicked_.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_release);
+        start_.signal();
+    }
+
+    void wait() const
+    {
+        const auto kicked = kicked_.load(std::memory_order_relaxed);
+        while (completed_.load(std::memory_order_acquire) != kicked) {
+            std::this_thread::yield();
+        }
+    }
+
+  private:
+    void run() override
+    {
+        while (!threadShouldExit()) {
+            if (!start_.wait(100)) continue;
+            if (threadShouldExit()) break;
+
+            const auto kicked = kicked_.load(std::memory_order_acquire);
+            if (kicked == completed_.load(std::memory_order_relaxed)) continue;
+            job_();
+            completed_.store(kicked, std::memory_order_release);
+        }
+        // a job kicked too late to run is not waited for
+        completed_.store(kicked_.load(std::memory_order_acquire),
+                         std::memory_order_release);
+    }
+
+    std::function<void()> job_;
+    juce::WaitableEvent start_;
+    // only written by the audio thread and the worker respectively
+    std::atomic<uint32_t> kicked_{0};
+    std::atomic<uint32_t> completed_{0};
+};
+
+} // namespace aether
@@ -5,9 +5,14 @@
 #include "juce_audio_processors/juce_audio_processors.h"
 #include "juce_core/juce_core.h"
 #include "juce_core/system/juce_PlatformDefs.h"
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstddef>
+#include <initializer_list>
+#include <limits>
 #include <memory>
+#include <tuple>
 
 namespace aether
 {
@@ -25,9 +30,18 @@ PluginProcessor::PluginProcessor() :
 
 PluginProcessor::~PluginProcessor()
 {
+    cancelPendingUpdate();
     for (auto *param : getParameters()) {
         param->removeListener(this);
     }
+
+    // the worker may still run on the dsp
+    if (jobPending_) springsWorker_.wait();
+    springsWorker_.stop();
+    if (dspPrepared_) {
+        springs_.free();
+        tapedelay_.free();
+    }
 }
 
 //==============================================================================
@@ -103,6 +117,26 @@ PluginProcessor::createLayout()
         std::make_unique<juce::AudioParameterFloat>(
             "springs_chaos", "Reverb Chaos",
             juce::NormalisableRange<float>{0.f, 100.f, 0.1f}, 25.f)));
+
+    layout.add(std::make_unique<juce::AudioProcessorParameterGroup>(
+        "routing", "Routing", "|",
+        std::make_unique<juce::AudioParameterChoice>(
+            "routing", "Routing",
+            juce::StringArray{"Delay > Reverb", "Parallel", "Reverb > Delay"},
+            0)));
+
+    layout.add(std::make_unique<juce::AudioProcessorParameterGroup>(
+        "engine", "Engine", "|",
+        std::make_unique<juce::AudioParameterBool>(
+            "engine_pipeline", "Multithreaded", false,
+            juce::AudioParameterBoolAttributes().withAutomatable(false)),
+        std::make_unique<juce::AudioParameterBool>(
+            "engine_internal_rate", "Fixed internal rate", false,
+            juce::AudioParameterBoolAttributes().withAutomatable(false)),
+        std::make_unique<juce::AudioParameterChoice>(
+            "engine_oversampling", "Oversampling",
+            juce::StringArray{"Off", "2x", "4x"}, 0,
+            juce::AudioParameterChoiceAttributes().withAutomatable(false))));
     return layout;
 }
 
@@ -121,7 +155,75 @@ bool PluginProcessor::producesMidi() const { return false; }
 
 bool PluginProcessor::isMidiEffect() const { return false; }
 
-double PluginProcessor::getTailLengthSeconds() const { return 0.0; }
+double PluginProcessor::getTailLengthSeconds() const
+{
+    auto value = [this](ParamId id) {
+        return static_cast<double>(getParamValue(id));
+    };
+
+    // time for the echoes to fall under the silence threshold
+    double tail = 0.0;
+    if (value(ParamId::kDelayActive) > 0.0) {
+        auto feedback = value(ParamId::kDelayFeedback) / 100.0;
+        if (feedback >= 1.0) {
+            return std::numeric_limits<double>::infinity();
+        }
+
+        auto time    = getDelayTimeSeconds();
+        auto repeats = 0.0;
+        if (feedback > 0.0) {
+            repeats = std::ceil(std::log(kSilenceGain) / std::log(feedback));
+        }
+        tail += time * (repeats + 1.0);
+    }
+
+    // springs decay is given as a T60
+    if (value(ParamId::kSpringsActive) > 0.0) {
+        auto t60 = value(ParamId::kSpringsDecay);
+        tail += t60 * std::log10(kSilenceGain) / -3.0 +
+                value(ParamId::kSpringsLength);
+    }
+
+    return tail;
+}
+
+double PluginProcessor::getDelayTimeSeconds() const
+{
+    auto timeType = static_cast<int>(getParamValue(ParamId::kDelayTimeType));
+    if (timeType > 0) {
+        auto beat = static_cast<int>(getParamValue(ParamId::kDelayBeats));
+        return 60.0 * getBeatsMultiplier(beat, timeType > 1) / bpm_;
+    }
+    return static_cast<double>(getParamValue(ParamId::kDelaySeconds));
+}
+
+int PluginProcessor::getBeatOffset(double ppq, double beat) const
+{
+    // ppq is the position of the first sample of the block
+    auto samplesPerBeat = 60.0 / bpm_ * coreSampleRate_;
+    auto offset         = std::ceil((beat - ppq) * samplesPerBeat);
+    return static_cast<int>(std::clamp(
+        offset, 0.0,
+        static_cast<double>(std::numeric_limits<int>::max())));
+}
+
+int PluginProcessor::getDrainSamples(ParamId id) const
+{
+    // a section switched off is drained once it stayed quiet for longer than
+    // the gap between two echoes or two reflections along the springs
+    auto seconds = id == ParamId::kDelayActive
+                       ? getDelayTimeSeconds()
+                       : static_cast<double>(
+                             getParamValue(ParamId::kSpringsLength));
+    return static_cast<int>(2.0 * seconds * coreSampleRate_);
+}
+
+float PluginProcessor::getParamValue(ParamId id) const
+{
+    auto *param = static_cast<juce::RangedAudioParameter *>(
+        getParameters()[static_cast<int>(id)]);
+    return param->convertFrom0to1(param->getValue());
+}
 
 int PluginProcessor::getNumPrograms()
 {
@@ -169,9 +271,88 @@ void PluginProcessor::setStateInformation(const void *data, int sizeInBytes)
 //==============================================================================
 void PluginProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-    auto fSampleRate = static_cast<float>(sampleRate);
-    springs_.prepare(fSampleRate, samplesPerBlock);
-    tapedelay_.prepare(fSampleRate, samplesPerBlock);
+    // the message thread prepares again on engine changes, see
+    // handleAsyncUpdate
+    const juce::ScopedLock lock(prepareLock_);
+    prepared_           = true;
+    preparedSampleRate_ = sampleRate;
+    preparedBlockSize_  = samplesPerBlock;
+
+    if (jobPending_) springsWorker_.wait();
+
+    const auto octaves     = getCoreOctaves(sampleRate);
+    const auto numChannels = std::max(getTotalNumInputChannels(),
+                                      getTotalNumOutputChannels());
+    resampler_.prepare(numChannels, samplesPerBlock, octaves);
+    coreSampleRate_ = std::ldexp(sampleRate, octaves);
+
+    const auto coreBlockSize = resampler_.getMaxCoreSize();
+    pipelineRing_.prepare(2 * coreBlockSize, coreBlockSize);
+    prepareBuffers(numChannels, samplesPerBlock, coreBlockSize);
+
+    // the dsp has no reset, preparing it again is the only way to clear the
+    // delay and springs state left by the last playback. Its allocations can
+    // only be kept across calls once it can reset in place.
+    auto fSampleRate = static_cast<float>(coreSampleRate_);
+    auto blockSize   = std::min(coreBlockSize, kBlockSize);
+    if (dspPrepared_) {
+        springs_.free();
+        tapedelay_.free();
+    }
+    springs_.prepare(fSampleRate, blockSize);
+    tapedelay_.prepare(fSampleRate, blockSize);
+    dspPrepared_ = true;
+
+    silentSamples_  = 0;
+    sleeping_       = false;
+    lastOutputPeak_ = 0.f;
+
+    // surround beds are downmixed to the stereo dsp and mixed back per channel
+    const auto layout = getChannelLayoutOfBus(false, 0);
+    surround_         = layout.size() > kNumChannels;
+    if (surround_) {
+        int numSends = 0;
+        for (int ch = 0; ch < layout.size() && ch < kMaxChannels; ++ch) {
+            auto role = getSurroundRole(layout.getTypeOfChannel(ch));
+            surroundRoles_[static_cast<size_t>(ch)] = role;
+            if (role != SurroundRole::kLfe) ++numSends;
+        }
+        sendGain_ = std::sqrt(2.f / static_cast<float>(numSends));
+    }
+
+    // surround and parallel routing mix dry/wet in the plugin
+    delayMix_.reset(getParamValue(ParamId::kDelayDrywet) / 100.f);
+    springsMix_.reset(getParamValue(ParamId::kSpringsDryWet) / 100.f);
+    springsWidth_.reset(getParamValue(ParamId::kSpringsWidth) / 100.f);
+    for (size_t i = 0; i < rearAllpass_.size(); ++i) {
+        rearAllpass_[i].prepare(static_cast<int>(
+            std::round(kRearAllpassSeconds[i] * coreSampleRate_)));
+    }
+
+    const auto fadeSamples =
+        static_cast<int>(std::round(kBypassFadeSeconds * coreSampleRate_));
+    delayBypass_.prepare(fadeSamples);
+    springsBypass_.prepare(fadeSamples);
+    delayBypass_.reset(!hostBypassed_ &&
+                       getParamValue(ParamId::kDelayActive) > 0.5f);
+    springsBypass_.reset(!hostBypassed_ &&
+                         getParamValue(ParamId::kSpringsActive) > 0.5f);
+
+    pipelineLatency_ = coreBlockSize;
+    jobPending_      = false;
+    pipelined_       = false;
+    delayed_         = false;
+    nextJob_         = {};
+    updatePipeline();
+
+    // dry/wet depend on the layout, send all values again to the dsp, they
+    // apply without ramp
+    for (size_t i = 0; i < rampValues_.size(); ++i) {
+        rampValues_[i] = getParamValue(static_cast<ParamId>(i));
+    }
+    for (auto *param : getParameters()) {
+        parameterValueChanged(param->getParameterIndex(), param->getValue());
+    }
 
     ///* Set springgl uniform values */
     // SpringsGL::setUniforms(m_springs.rms.rms, &m_springs.rms.rms_id,
@@ -179,213 +360,1089 @@ void PluginProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
     //                        &m_springs.desc.ftr);
 }
 
+void PluginProcessor::prepareBuffers(int numChannels, int samplesPerBlock,
+                                     int coreBlockSize)
+{
+    struct ArenaBuffer {
+        juce::AudioBuffer<float> *buffer;
+        int numChannels;
+        int numSamples;
+    };
+    // hosts may switch precision without preparing again, the float buffer
+    // is always there
+    const std::array<ArenaBuffer, 5> buffers{{
+        {&floatBuffer_, numChannels, samplesPerBlock},
+        {&coreBuffer_, numChannels,
+         resampler_.isActive() ? coreBlockSize : 0},
+        {&scratch_, kNumScratch, kBlockSize},
+        {&jobBuffer_, kNumChannels, coreBlockSize},
+        {&pipelineFifo_, std::max(numChannels, kNumChannels),
+         pipelineRing_.getStorageSize()},
+    }};
+
+    // channels start on their own cache line
+    size_t footprint = 0;
+    for (const auto &b : buffers) {
+        footprint += static_cast<size_t>(b.numChannels) *
+                     Arena::getSize(static_cast<size_t>(b.numSamples));
+    }
+    arena_.prepare(footprint);
+    footprint_ = arena_.getCapacity();
+
+    std::array<float *, std::max(kMaxChannels, int{kNumScratch})> channels{};
+    for (const auto &b : buffers) {
+        jassert(b.numChannels <= static_cast<int>(channels.size()));
+        for (int ch = 0; ch < b.numChannels; ++ch) {
+            channels[static_cast<size_t>(ch)] =
+                arena_.take(static_cast<size_t>(b.numSamples));
+        }
+        b.buffer->setDataToReferTo(channels.data(), b.numChannels,
+                                   b.numSamples);
+    }
+}
+
 void PluginProcessor::releaseResources()
 {
-    springs_.free();
-    tapedelay_.free();
+    const juce::ScopedLock lock(prepareLock_);
+    prepared_ = false;
+
+    if (jobPending_) springsWorker_.wait();
+    jobPending_ = false;
+    pipelineEnabled_.store(false);
+    springsWorker_.stop();
+
+    // the delay lines are only kept while the host has the processor prepared
+    if (dspPrepared_) {
+        springs_.free();
+        tapedelay_.free();
+        dspPrepared_ = false;
+    }
 }
 
 bool PluginProcessor::isBusesLayoutSupported(const BusesLayout &layouts) const
 {
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
-        return false;
+    const auto &in  = layouts.getMainInputChannelSet();
+    const auto &out = layouts.getMainOutputChannelSet();
+
+    // mono -> mono, mono -> stereo and stereo -> stereo
+    if (out == juce::AudioChannelSet::stereo())
+        return in == juce::AudioChannelSet::stereo() ||
+               in == juce::AudioChannelSet::mono();
+
+    if (out == juce::AudioChannelSet::mono())
+        return in == juce::AudioChannelSet::mono();
+
+    // surround beds
+    if (out == juce::AudioChannelSet::quadraphonic() ||
+        out == juce::AudioChannelSet::create5point1() ||
+        out == juce::AudioChannelSet::create7point1())
+        return in == out;
+
+    return false;
+}
+
+PluginProcessor::SurroundRole
+PluginProcessor::getSurroundRole(juce::AudioChannelSet::ChannelType type)
+{
+    using Set  = juce::AudioChannelSet;
+    auto isAny = [type](std::initializer_list<Set::ChannelType> types) {
+        return std::find(types.begin(), types.end(), type) != types.end();
+    };
+    if (isAny({Set::left, Set::leftCentre, Set::wideLeft}))
+        return SurroundRole::kFrontLeft;
+    if (isAny({Set::right, Set::rightCentre, Set::wideRight}))
+        return SurroundRole::kFrontRight;
+    if (isAny({Set::leftSurround, Set::leftSurroundSide,
+               Set::leftSurroundRear}))
+        return SurroundRole::kRearLeft;
+    if (isAny({Set::rightSurround, Set::rightSurroundSide,
+               Set::rightSurroundRear}))
+        return SurroundRole::kRearRight;
+    if (isAny({Set::LFE, Set::LFE2})) return SurroundRole::kLfe;
+    // the centre and the channels of larger layouts get the centre send
+    return SurroundRole::kCentre;
+}
 
-    // This checks if the input layout matches the output layout
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
-        return false;
+template <typename Fn>
+void PluginProcessor::splitBlock(const ParamEvent *events, int numEvents,
+                                 int count, Fn &&fn)
+{
+    // split the block in chunks of at most kBlockSize samples and at every
+    // event. fn gets the events started so far, those due in the chunk are
+    // sent with their value at its end so that ramps span the rest of the
+    // block. A setter is always followed by exactly one process call of the
+    // same length.
+    const auto *event = events;
+    const auto *last  = events + numEvents;
+    for (int pos = 0; pos < count;) {
+        while (event != last && event->offset <= pos) ++event;
 
-    return true;
+        auto end = event != last ? event->offset : count;
+        end      = std::min(end, pos + kBlockSize);
+        fn(pos, end - pos, events, event);
+        pos = end;
+    }
 }
 
 void PluginProcessor::processBlock(juce::AudioBuffer<float> &buffer,
                                    juce::MidiBuffer &midiMessages)
 {
     juce::ignoreUnused(midiMessages);
+    process(buffer, false);
+}
 
+void PluginProcessor::processBlock(juce::AudioBuffer<double> &buffer,
+                                   juce::MidiBuffer &midiMessages)
+{
+    juce::ignoreUnused(midiMessages);
+    process(buffer, false);
+}
+
+void PluginProcessor::processBlockBypassed(juce::AudioBuffer<float> &buffer,
+                                           juce::MidiBuffer &midiMessages)
+{
+    juce::ignoreUnused(midiMessages);
+    process(buffer, true);
+}
+
+void PluginProcessor::processBlockBypassed(juce::AudioBuffer<double> &buffer,
+                                           juce::MidiBuffer &midiMessages)
+{
+    juce::ignoreUnused(midiMessages);
+    process(buffer, true);
+}
+
+void PluginProcessor::process(juce::AudioBuffer<float> &buffer, bool bypassed)
+{
     int count = buffer.getNumSamples();
+    if (count == 0) return;
 
-    ParamEvent event;
-    while (paramEvents_.try_dequeue(event)) {
-        switch (event.id) {
-        case ParamId::kDelayActive:
-            activeTapeDelay_ = event.value > 0.f;
-            break;
-        case ParamId::kDelayDrywet:
-            tapedelay_.setDryWet(event.value / 100.f, count);
-            break;
-        case ParamId::kDelayTimeType:
-            useBeats_ = event.value > 0.f;
-            if (useBeats_) {
-                isDotted_   = event.value > 1.f;
-                auto *param = static_cast<juce::AudioParameterChoice *>(
-                    getParameters()[static_cast<size_t>(ParamId::kDelayBeats)]);
-                event.value = static_cast<float>(*param);
-            } else {
-                auto *param = static_cast<juce::AudioParameterFloat *>(
-                    getParameters()[static_cast<size_t>(
-                        ParamId::kDelaySeconds)]);
-                event.value = *param;
+    // host bypass switches both sections off, their tails ring out and the
+    // output keeps the pipeline latency
+    if (bypassed != hostBypassed_) {
+        hostBypassed_ = bypassed;
+        for (auto id : {ParamId::kDelayActive, ParamId::kSpringsActive}) {
+            paramMailbox_.post(static_cast<size_t>(id), getParamValue(id));
+        }
+    }
+
+    // mono -> stereo, both dsp channels start from the mono input
+    if (getTotalNumInputChannels() == 1 && buffer.getNumChannels() > 1) {
+        buffer.copyFrom(1, 0, buffer, 0, 0, count);
+    }
+
+    // the transport is followed while sleeping so that tempo and beat sync
+    // are up to date on wake up
+    updateTransport();
+
+    // stop processing once the input has been silent for longer than the tail,
+    // the dsp state is then below the threshold and resumes without click
+    if (buffer.getMagnitude(0, count) > kSilenceGain || shake_.load()) {
+        silentSamples_ = 0;
+        sleeping_      = false;
+    } else if (!sleeping_) {
+        silentSamples_ += count;
+        auto tail = getTailLengthSeconds() * getSampleRate();
+        sleeping_ = static_cast<double>(silentSamples_) > tail &&
+                    lastOutputPeak_ < kSilenceGain;
+    }
+    // parameter changes stay in the mailbox until we wake up, nothing rings
+    // in the delay so its time jumps to the new tempo instead of gliding
+    if (sleeping_) {
+        if (useBeats_ && bpm_ != dspBpm_) {
+            paramMailbox_.post(static_cast<size_t>(ParamId::kDelayBeats),
+                               getParamValue(ParamId::kDelayBeats));
+        }
+        dspBpm_ = bpm_;
+        return;
+    }
+
+    if (resampler_.isActive()) {
+        processResampled(buffer);
+    } else {
+        processCore(buffer);
+    }
+
+    if (silentSamples_ > 0) {
+        lastOutputPeak_ = buffer.getMagnitude(0, count);
+    }
+}
+
+void PluginProcessor::updateTransport()
+{
+    ppq_ = juce::nullopt;
+
+    auto *playHead = getPlayHead();
+    if (playHead == nullptr) return;
+    const auto position = playHead->getPosition();
+    if (!position.hasValue()) return;
+
+    auto bpm = position->getBpm();
+    if (bpm.hasValue()) bpm_ = *bpm;
+
+    if (position->getIsPlaying()) {
+        ppq_ = position->getPpqPosition();
+    }
+}
+
+void PluginProcessor::processResampled(juce::AudioBuffer<float> &buffer)
+{
+    // the dsp runs at the core rate between the two resampling stages
+    const auto numChannels = buffer.getNumChannels();
+    const auto count       = buffer.getNumSamples();
+    const auto maxBlock    = resampler_.getMaxBlockSize();
+    jassert(numChannels == coreBuffer_.getNumChannels());
+
+    for (int pos = 0; pos < count; pos += maxBlock) {
+        const auto n = std::min(count - pos, maxBlock);
+        juce::AudioBuffer<float> host(buffer.getArrayOfWritePointers(),
+                                      numChannels, pos, n);
+
+        auto *const *corePtrs = coreBuffer_.getArrayOfWritePointers();
+        auto coreCount =
+            resampler_.toCore(host.getArrayOfReadPointers(), corePtrs, n);
+        juce::AudioBuffer<float> core(corePtrs, numChannels, coreCount);
+        if (coreCount > 0) processCore(core);
+
+        resampler_.fromCore(core.getArrayOfReadPointers(), coreCount,
+                            host.getArrayOfWritePointers(), n);
+    }
+}
+
+void PluginProcessor::processCore(juce::AudioBuffer<float> &buffer)
+{
+    const auto count = buffer.getNumSamples();
+
+    // collect parameter events and sort them by sample offset
+    int numEvents = 0;
+    auto addEvent = [this, count, &numEvents](ParamEvent event) {
+        event.offset = juce::jlimit(0, count - 1, event.offset);
+        auto i       = static_cast<size_t>(numEvents++);
+        for (; i > 0 && blockEvents_[i - 1].offset > event.offset; --i) {
+            blockEvents_[i] = blockEvents_[i - 1];
+        }
+        blockEvents_[i] = event;
+    };
+    paramMailbox_.collect([this, &addEvent](size_t id, float value,
+                                            int offset) {
+        const auto paramId = static_cast<ParamId>(id);
+        if (hostBypassed_ && (paramId == ParamId::kDelayActive ||
+                              paramId == ParamId::kSpringsActive)) {
+            value = 0.f;
+        }
+        ParamEvent event{static_cast<int>(id), value, offset};
+        if (isRampedParam(paramId)) {
+            event.start     = rampValues_[id];
+            rampValues_[id] = value;
+        }
+        addEvent(event);
+    });
+
+    // the delay time glides from the tempo of the previous block
+    const double prevBpm    = dspBpm_;
+    const bool tempoChanged = useBeats_ && bpm_ != prevBpm;
+    dspBpm_                 = bpm_;
+
+    if (ppq_.hasValue()) {
+        // the reverse modes restart on the sample of each beat, setting the
+        // mode again resyncs them
+        if (useBeats_ &&
+            tapedelay_.getMode() != processors::TapeDelay::Mode::kNormal) {
+            // playback start and transport jumps arm the next beat again
+            if (nextSync_ < *ppq_ - 0.5 || nextSync_ > *ppq_ + 1.0) {
+                nextSync_ = std::ceil(*ppq_);
             }
-        case ParamId::kDelayBeats:
-            if (useBeats_) {
-                auto id = static_cast<int>(event.value);
-                double mult;
-                switch (id) {
-                case kBeat132:
-                    mult = 1.0 / 32.0;
-                    break;
-                case kBeat116:
-                    mult = 1.0 / 16.0;
-                    break;
-                case kBeat18:
-                    mult = 1.0 / 8.0;
-                    break;
-                case kBeat16:
-                    mult = 1.0 / 6.0;
-                    break;
-                case kBeat14:
-                    mult = 1.0 / 4.0;
-                    break;
-                case kBeat13:
-                    mult = 1.0 / 3.0;
-                    break;
-                case kBeat12:
-                    mult = 1.0 / 2.0;
-                    break;
-                default:
-                case kBeat1:
-                    mult = 1.0;
-                    break;
-                case kBeat2:
-                    mult = 2.0;
-                    break;
-                case kBeat4:
-                    mult = 4.0;
-                    break;
-                }
-                if (isDotted_) {
-                    mult += mult * 0.5;
-                }
-                beatsMult_ = mult;
-                auto time  = static_cast<float>(60 * mult / bpm_);
-                tapedelay_.setDelay(time, count);
-                break;
-            } else if (event.id == ParamId::kDelayBeats) {
-                break;
+            for (int i = 0; i < kMaxSyncEvents; ++i) {
+                auto offset = getBeatOffset(*ppq_, nextSync_);
+                if (offset >= count) break;
+                addEvent({static_cast<int>(ParamId::kDelayMode),
+                          getParamValue(ParamId::kDelayMode), offset});
+                nextSync_ += 1.0;
             }
-        case ParamId::kDelaySeconds:
-            if (!useBeats_) {
-                tapedelay_.setDelay(event.value, count);
+        }
+        // position of the next block, resampled blocks are processed in
+        // several parts
+        *ppq_ += count * bpm_ / (60.0 * coreSampleRate_);
+    }
+
+    // springs of the previous block run on the worker while the delay
+    // processes this one. The output is delayed by the pipeline latency
+    // whenever it is reported, blocks that cannot be pipelined go through
+    // the ring after being processed inline.
+    const bool delayed   = pipelineEnabled_.load();
+    const bool pipelined = delayed && !surround_ &&
+                           routing_.load() == Routing::kSerial &&
+                           buffer.getNumChannels() == kNumChannels &&
+                           count <= pipelineLatency_;
+    if (delayed && !delayed_) {
+        pipelineFifo_.clear();
+        pipelineRing_.reset();
+    }
+    delayed_ = delayed;
+    if (pipelined != pipelined_) {
+        // the output of the last pipelined block is still due
+        if (jobPending_) collectSpringsJob();
+        jobPending_ = false;
+        pipelined_  = pipelined;
+    }
+
+    // shake springs
+    if (shake_.load()) {
+        shake_.store(false);
+        if (pipelined_) {
+            nextJob_.shake = true;
+        } else {
+            springs_.shake();
+        }
+    }
+
+    splitBlock(blockEvents_.data(), numEvents, count,
+               [&](int pos, int subCount, const ParamEvent *first,
+                   const ParamEvent *last) {
+                   if (tempoChanged) {
+                       // the tempo moves linearly from its previous value
+                       // over the block, the delay time follows it at the end
+                       // of every chunk
+                       auto ratio = static_cast<double>(pos + subCount) / count;
+                       auto bpm   = prevBpm + (bpm_ - prevBpm) * ratio;
+                       auto time  = static_cast<float>(60.0 * beatsMult_ / bpm);
+                       tapedelay_.setDelay(time, subCount);
+                   }
+                   for (const auto *event = first; event != last; ++event) {
+                       if (event->isDue(pos)) {
+                           applyParamEvent(*event, pos, subCount, count);
+                       }
+                   }
+                   processRange(buffer, pos, subCount);
+               });
+
+    if (pipelined_) {
+        processPipeline(buffer);
+    } else if (delayed_) {
+        delayOutput(buffer);
+    }
+
+    // update rms buffer position
+    if (!pipelined_) {
+        rmsPos_.store(static_cast<int>(*springs_.getRMSStackPos()));
+    }
+}
+
+void PluginProcessor::processPipeline(juce::AudioBuffer<float> &buffer)
+{
+    const auto count = buffer.getNumSamples();
+
+    // collect the springs output of the previous block
+    if (jobPending_) collectSpringsJob();
+
+    // hand the delay output of this block to the worker
+    springsJob_       = nextJob_;
+    springsJob_.count = count;
+    nextJob_          = {};
+    for (int ch = 0; ch < kNumChannels; ++ch) {
+        jobBuffer_.copyFrom(ch, 0, buffer, ch, 0, count);
+    }
+    springsWorker_.kick();
+    jobPending_ = true;
+
+    // output is read one maximum block size behind
+    for (int ch = 0; ch < kNumChannels; ++ch) {
+        const auto *fifo = pipelineRing_.read(pipelineFifo_.getReadPointer(ch),
+                                              pipelineLatency_);
+        std::copy(fifo, fifo + count, buffer.getWritePointer(ch));
+    }
+}
+
+void PluginProcessor::collectSpringsJob()
+{
+    springsWorker_.wait();
+    for (int ch = 0; ch < kNumChannels; ++ch) {
+        pipelineRing_.write(pipelineFifo_.getWritePointer(ch),
+                            jobBuffer_.getReadPointer(ch), springsJob_.count);
+    }
+    pipelineRing_.advance(springsJob_.count);
+}
+
+void PluginProcessor::delayOutput(juce::AudioBuffer<float> &buffer)
+{
+    // the block was processed inline, it is read back the pipeline latency
+    // later, like the springs output of pipelined blocks
+    const auto numChannels = buffer.getNumChannels();
+    const auto count       = buffer.getNumSamples();
+    jassert(numChannels <= pipelineFifo_.getNumChannels());
+
+    for (int pos = 0; pos < count; pos += pipelineLatency_) {
+        const auto n = std::min(count - pos, pipelineLatency_);
+        for (int ch = 0; ch < numChannels; ++ch) {
+            pipelineRing_.write(pipelineFifo_.getWritePointer(ch),
+                                buffer.getReadPointer(ch, pos), n);
+        }
+        pipelineRing_.advance(n);
+        for (int ch = 0; ch < numChannels; ++ch) {
+            const auto *fifo = pipelineRing_.read(
+                pipelineFifo_.getReadPointer(ch), pipelineLatency_ + n);
+            std::copy(fifo, fifo + n, buffer.getWritePointer(ch, pos));
+        }
+    }
+}
+
+void PluginProcessor::processSpringsJob()
+{
+    const auto &job = springsJob_;
+    if (job.shake) springs_.shake();
+
+    splitBlock(job.events.data(), job.numEvents, job.count,
+               [this, &job](int pos, int subCount, const ParamEvent *first,
+                            const ParamEvent *last) {
+                   for (const auto *event = first; event != last; ++event) {
+                       if (event->isDue(pos)) {
+                           applySpringsEvent(*event, pos, subCount, job.count);
+                       }
+                   }
+                   float *io[kNumChannels] = {
+                       jobBuffer_.getWritePointer(0, pos),
+                       jobBuffer_.getWritePointer(1, pos)};
+                   processSprings(io, subCount);
+               });
+
+    rmsPos_.store(static_cast<int>(*springs_.getRMSStackPos()));
+}
+
+void PluginProcessor::updatePipeline()
+{
+    bool enable = getParamValue(ParamId::kPipeline) > 0.5f;
+    if (enable) {
+        enable = springsWorker_.start();
+    }
+    pipelineEnabled_.store(enable);
+
+    // the pipeline delay is counted at the core rate
+    auto latency = resampler_.getLatency();
+    if (enable) latency += resampler_.toHostSamples(pipelineLatency_);
+    setLatencySamples(latency);
+}
+
+void PluginProcessor::handleAsyncUpdate()
+{
+    // serialised with the host calls to prepareToPlay and releaseResources,
+    // a released processor is left for the host to prepare
+    {
+        const juce::ScopedLock lock(prepareLock_);
+        if (!prepared_) return;
+        if (getCoreOctaves(preparedSampleRate_) == resampler_.getOctaves()) {
+            updatePipeline();
+            return;
+        }
+    }
+
+    // a new core rate needs the dsp prepared again, out of the audio
+    // callback. The callback lock is taken before ours, like hosts that
+    // prepare while holding it.
+    suspendProcessing(true);
+    {
+        const juce::ScopedLock lock(prepareLock_);
+        if (prepared_) prepareToPlay(preparedSampleRate_, preparedBlockSize_);
+    }
+    suspendProcessing(false);
+}
+
+int PluginProcessor::getCoreOctaves(double sampleRate) const
+{
+    // high host rates can run the dsp at 44.1 or 48kHz, the springs damping
+    // tops out at 12kHz anyway
+    int octaves = 0;
+    if (getParamValue(ParamId::kInternalRate) > 0.5f) {
+        while (octaves > -Resampler::kMaxDownOctaves &&
+               std::ldexp(sampleRate, octaves) > kMaxInternalRate) {
+            --octaves;
+        }
+    }
+
+    // the dsp runs at two or four times that rate for less aliasing in the
+    // saturation and finer delay interpolation, at least twice for offline
+    // renders which have no deadline
+    auto oversampling =
+        static_cast<int>(getParamValue(ParamId::kOversampling));
+    if (isNonRealtime()) oversampling = std::max(oversampling, 1);
+    octaves += oversampling;
+
+    // the oversampled rate is capped at that multiple of kMaxInternalRate,
+    // high host rates are not run at up to 768kHz with delay lines to match
+    while (octaves > 0 && std::ldexp(sampleRate, octaves) >
+                              std::ldexp(kMaxInternalRate, oversampling)) {
+        --octaves;
+    }
+    return std::min(octaves, Resampler::kMaxOctaves);
+}
+
+void PluginProcessor::process(juce::AudioBuffer<double> &buffer, bool bypassed)
+{
+    // the dsp runs in single precision, only the difference it adds to the
+    // signal goes through float so the dry path keeps its full precision.
+    // With latency the output no longer lines up with the input, the dry
+    // signal has gone through the resampler or the pipeline ring in float.
+    const bool aligned     = getLatencySamples() == 0;
+    const auto numChannels = buffer.getNumChannels();
+    const auto numInputs   = getTotalNumInputChannels();
+    const auto count       = buffer.getNumSamples();
+    const auto capacity    = floatBuffer_.getNumSamples();
+    if (capacity == 0 || numChannels > floatBuffer_.getNumChannels()) {
+        jassertfalse;
+        return;
+    }
+
+    for (int pos = 0; pos < count; pos += capacity) {
+        const auto n = std::min(count - pos, capacity);
+        juce::AudioBuffer<float> block(floatBuffer_.getArrayOfWritePointers(),
+                                       numChannels, n);
+        for (int ch = 0; ch < numChannels; ++ch) {
+            const auto *in = buffer.getReadPointer(ch, pos);
+            auto *out      = block.getWritePointer(ch);
+            for (int i = 0; i < n; ++i) out[i] = static_cast<float>(in[i]);
+        }
+
+        process(block, bypassed);
+
+        // outputs that are not inputs hold garbage, they get the dsp output
+        for (int ch = 0; ch < numChannels; ++ch) {
+            auto *io        = buffer.getWritePointer(ch, pos);
+            const auto *out = block.getReadPointer(ch);
+            if (!aligned || ch >= numInputs) {
+                for (int i = 0; i < n; ++i) io[i] = static_cast<double>(out[i]);
+                continue;
             }
+            for (int i = 0; i < n; ++i) {
+                auto dry = static_cast<float>(io[i]);
+                io[i] += static_cast<double>(out[i] - dry);
+            }
+        }
+    }
+}
+
+void PluginProcessor::processRange(juce::AudioBuffer<float> &buffer,
+                                   int offset, int count)
+{
+    if (surround_) {
+        processSurroundRange(buffer, offset, count);
+        return;
+    }
+
+    // the dsp is stereo, in mono the second channel runs in a scratch buffer
+    // and both channels are folded back at the end. Mono thus costs the stereo
+    // dsp plus a copy and a fold, slightly more than stereo, until the dsp
+    // can run a single channel.
+    const bool mono = buffer.getNumChannels() == 1;
+
+    float *outs[kNumChannels];
+    outs[0] = buffer.getWritePointer(0, offset);
+    if (mono) {
+        outs[1] = monoScratch_.data();
+        juce::FloatVectorOperations::copy(outs[1], outs[0], count);
+    } else {
+        outs[1] = buffer.getWritePointer(1, offset);
+    }
+
+    if (pipelined_) {
+        // the springs run later on the worker thread
+        processDelay(outs, count);
+    } else {
+        switch (routing_.load()) {
+        case Routing::kSerial:
+            processDelay(outs, count);
+            processSprings(outs, count);
             break;
-        case ParamId::kDelayFeedback:
-            tapedelay_.setFeedback(event.value / 100.f, count);
-            break;
-        case ParamId::kDelayCutLow:
-            tapedelay_.setCutLowPass(event.value, count);
-            break;
-        case ParamId::kDelayCutHi:
-            tapedelay_.setCutHiPass(event.value, count);
-            break;
-        case ParamId::kDelaySaturation:
-            tapedelay_.setSaturation(event.value, count);
+        case Routing::kSpringsDelay:
+            processSprings(outs, count);
+            processDelay(outs, count);
             break;
-        case ParamId::kDelayDrift:
-            tapedelay_.setDrift(event.value / 100.f, count);
+        case Routing::kParallel:
+            processParallel(outs, count);
             break;
-        case ParamId::kDelayMode:
-            tapedelay_.setMode(
-                static_cast<decltype(tapedelay_)::Mode>(event.value), count);
+        }
+    }
+
+    if (mono) {
+        juce::FloatVectorOperations::multiply(outs[0], 0.5f, count);
+        juce::FloatVectorOperations::addWithMultiply(outs[0], outs[1], 0.5f,
+                                                     count);
+    }
+}
+
+void PluginProcessor::processParallel(float *const *io, int count)
+{
+    // both sections run wet only on the same input
+    auto [delayMix, delayStep]     = delayMix_.advance();
+    auto [springsMix, springsStep] = springsMix_.advance();
+
+    auto *const *scratch         = scratch_.getArrayOfWritePointers();
+    float *delay[kNumChannels]   = {scratch[kDelayL], scratch[kDelayR]};
+    float *springs[kNumChannels] = {scratch[kSpringsL], scratch[kSpringsR]};
+    if (delayBypass_.isProcessing()) {
+        for (int c = 0; c < kNumChannels; ++c) {
+            juce::FloatVectorOperations::copy(delay[c], io[c], count);
+        }
+        processDelay(delay, count);
+    } else {
+        delayMix = delayStep = 0.f;
+    }
+    if (springsBypass_.isProcessing()) {
+        for (int c = 0; c < kNumChannels; ++c) {
+            juce::FloatVectorOperations::copy(springs[c], io[c], count);
+        }
+        processSprings(springs, count);
+    } else {
+        springsMix = springsStep = 0.f;
+    }
+
+    for (int c = 0; c < kNumChannels; ++c) {
+        mixParallel(io[c], io[c], delay[c], delayMix, delayStep, springs[c],
+                    springsMix, springsStep, count);
+    }
+}
+
+template <typename Processor>
+std::pair<float, float>
+PluginProcessor::runSection(SectionBypass &section, Processor &processor,
+                            float *const *io, float *const *dry, int count)
+{
+    if (section.getState() == SectionBypass::State::kActive) {
+        processor.process(io, io, count);
+        return {1.f, 0.f};
+    }
+
+    // fading or draining, the input that no longer enters the section is
+    // added back after it when a dry buffer is given
+    const auto [gain, step] = section.advance(count);
+    for (int c = 0; c < kNumChannels; ++c) {
+        if (dry != nullptr) {
+            juce::FloatVectorOperations::copy(dry[c], io[c], count);
+        }
+        applyFade(io[c], io[c], gain, step, count);
+    }
+    processor.process(io, io, count);
+
+    if (section.getState() == SectionBypass::State::kDraining) {
+        float peak = 0.f;
+        for (int c = 0; c < kNumChannels; ++c) {
+            auto range =
+                juce::FloatVectorOperations::findMinAndMax(io[c], count);
+            peak = std::max({peak, -range.getStart(), range.getEnd()});
+        }
+        section.drain(peak < kSilenceGain, count);
+    }
+
+    if (dry != nullptr) {
+        for (int c = 0; c < kNumChannels; ++c) {
+            addBypassed(io[c], io[c], dry[c], gain, step, count);
+        }
+    }
+    return {gain, step};
+}
+
+void PluginProcessor::processDelay(float *const *io, int count)
+{
+    if (!delayBypass_.isProcessing()) return;
+    auto *const *scratch     = scratch_.getArrayOfWritePointers();
+    float *dry[kNumChannels] = {scratch[kDelayDryL], scratch[kDelayDryR]};
+    runSection(delayBypass_, tapedelay_, io, dry, count);
+}
+
+void PluginProcessor::processSprings(float *const *io, int count)
+{
+    if (!springsBypass_.isProcessing()) return;
+    auto *const *scratch     = scratch_.getArrayOfWritePointers();
+    float *dry[kNumChannels] = {scratch[kSpringsDryL], scratch[kSpringsDryR]};
+    runSection(springsBypass_, springs_, io, dry, count);
+}
+
+void PluginProcessor::processSurroundRange(juce::AudioBuffer<float> &buffer,
+                                           int offset, int count)
+{
+    // the dsp runs wet only, dry/wet are applied here for each channel
+    // plain variables, the ramps are captured by the lambdas below
+    float delayMix, delayStep, springsMix, springsStep, width, widthStep;
+    std::tie(delayMix, delayStep)     = delayMix_.advance();
+    std::tie(springsMix, springsStep) = springsMix_.advance();
+    std::tie(width, widthStep)        = springsWidth_.advance();
+
+    auto *const *scratch = scratch_.getArrayOfWritePointers();
+    float *send[kNumChannels]    = {scratch[kSendL], scratch[kSendR]};
+    float *delay[kNumChannels]   = {scratch[kDelayL], scratch[kDelayR]};
+    float *springs[kNumChannels] = {scratch[kSpringsL], scratch[kSpringsR]};
+    float *rear[kNumChannels]    = {scratch[kRearL], scratch[kRearR]};
+    constexpr auto kCentreGain   = 0.70710678f;
+
+    // downmix to the stereo dsp input
+    juce::FloatVectorOperations::clear(send[0], count);
+    juce::FloatVectorOperations::clear(send[1], count);
+    const auto numChannels = std::min(buffer.getNumChannels(), kMaxChannels);
+    for (int ch = 0; ch < numChannels; ++ch) {
+        const auto *in = buffer.getReadPointer(ch, offset);
+        switch (surroundRoles_[static_cast<size_t>(ch)]) {
+        case SurroundRole::kFrontLeft:
+        case SurroundRole::kRearLeft:
+            juce::FloatVectorOperations::addWithMultiply(send[0], in,
+                                                         sendGain_, count);
             break;
-        case ParamId::kSpringsActive:
-            activeSprings_ = event.value > 0;
+        case SurroundRole::kFrontRight:
+        case SurroundRole::kRearRight:
+            juce::FloatVectorOperations::addWithMultiply(send[1], in,
+                                                         sendGain_, count);
             break;
-        case ParamId::kSpringsDryWet:
-            springs_.setDryWet(event.value / 100.f, count);
+        case SurroundRole::kCentre:
+            for (auto *s : send) {
+                juce::FloatVectorOperations::addWithMultiply(
+                    s, in, sendGain_ * kCentreGain, count);
+            }
             break;
-        case ParamId::kSpringsWidth:
-            springs_.setWidth(event.value / 100.f, count);
+        case SurroundRole::kLfe:
             break;
-        case ParamId::kSpringsLength:
-            springs_.setTd(event.value, count);
+        }
+    }
+
+    // in series, the second section is fed with the output of the first as
+    // in stereo
+    const auto routing = routing_.load();
+    std::pair<float, float> delayFade{1.f, 0.f};
+    std::pair<float, float> springsFade{1.f, 0.f};
+
+    // a section fading out or draining leaves the signal it no longer
+    // receives at unity next to its wet output
+    auto withBypassed = [count](const float *wet, const float *dry,
+                                std::pair<float, float> fade, float *tmp) {
+        if (fade.first == 1.f && fade.second == 0.f) return wet;
+        addBypassed(tmp, wet, dry, fade.first, fade.second, count);
+        return static_cast<const float *>(tmp);
+    };
+
+    auto runDelay = [&] {
+        if (!delayBypass_.isProcessing()) return;
+        for (int c = 0; c < kNumChannels; ++c) {
+            juce::FloatVectorOperations::copy(delay[c], send[c], count);
+        }
+        delayFade = runSection(delayBypass_, tapedelay_, delay, nullptr, count);
+        crossfade(scratch[kDelayCentre], delay[0], delay[1], 0.5f, 0.f, count);
+
+        if (routing == Routing::kSerial) {
+            for (int c = 0; c < kNumChannels; ++c) {
+                auto *wet = withBypassed(delay[c], send[c], delayFade,
+                                         scratch[kDelayDryL]);
+                crossfade(send[c], send[c], wet, delayMix, delayStep, count);
+            }
+        }
+    };
+    auto runSprings = [&] {
+        if (!springsBypass_.isProcessing()) return;
+        for (int c = 0; c < kNumChannels; ++c) {
+            juce::FloatVectorOperations::copy(springs[c], send[c], count);
+        }
+        springsFade =
+            runSection(springsBypass_, springs_, springs, nullptr, count);
+        crossfade(scratch[kSpringsCentre], springs[0], springs[1], 0.5f, 0.f,
+                  count);
+
+        // the rears share the mid of the fronts, width moves their side from
+        // the front one to its mirror taken through allpasses, so that wide
+        // settings also decorrelate the rears from the fronts
+        auto *side = scratch[kRearSide];
+        for (int i = 0; i < count; ++i) {
+            side[i] = 0.5f * (springs[0][i] - springs[1][i]);
+        }
+        rearAllpass_[0].process(rear[0], side, count);
+        for (size_t i = 1; i < rearAllpass_.size(); ++i) {
+            rearAllpass_[i].process(rear[0], rear[0], count);
+        }
+        juce::FloatVectorOperations::negate(rear[0], rear[0], count);
+        crossfade(side, side, rear[0], width, widthStep, count);
+        for (int i = 0; i < count; ++i) {
+            const auto mid = 0.5f * (springs[0][i] + springs[1][i]);
+            rear[0][i]     = mid + side[i];
+            rear[1][i]     = mid - side[i];
+        }
+
+        if (routing == Routing::kSpringsDelay) {
+            for (int c = 0; c < kNumChannels; ++c) {
+                auto *wet = withBypassed(springs[c], send[c], springsFade,
+                                         scratch[kSpringsDryL]);
+                crossfade(send[c], send[c], wet, springsMix, springsStep,
+                          count);
+            }
+        }
+    };
+
+    if (routing == Routing::kSpringsDelay) {
+        runSprings();
+        runDelay();
+    } else {
+        runDelay();
+        runSprings();
+    }
+    if (!delayBypass_.isProcessing()) delayMix = delayStep = 0.f;
+    if (!springsBypass_.isProcessing()) springsMix = springsStep = 0.f;
+
+    for (int ch = 0; ch < numChannels; ++ch) {
+        auto role = surroundRoles_[static_cast<size_t>(ch)];
+        if (role == SurroundRole::kLfe) continue;
+
+        const float *delayWet   = scratch[kDelayCentre];
+        const float *springsWet = scratch[kSpringsCentre];
+        switch (role) {
+        case SurroundRole::kFrontLeft:
+            delayWet   = delay[0];
+            springsWet = springs[0];
             break;
-        case ParamId::kSpringsDecay:
-            springs_.setT60(event.value, count);
+        case SurroundRole::kFrontRight:
+            delayWet   = delay[1];
+            springsWet = springs[1];
             break;
-        case ParamId::kSpringsTone:
-            springs_.setTone(event.value, count);
+        case SurroundRole::kRearLeft:
+            delayWet   = delay[0];
+            springsWet = rear[0];
             break;
-        case ParamId::kSpringsScatter:
-            springs_.setScatter(event.value / 100.f, count);
+        case SurroundRole::kRearRight:
+            delayWet   = delay[1];
+            springsWet = rear[1];
             break;
-        case ParamId::kSpringsDamp:
-            springs_.setFreq(event.value, count);
+        case SurroundRole::kCentre:
+        case SurroundRole::kLfe:
             break;
-        case ParamId::kSpringsChaos:
-            springs_.setChaos(event.value / 100.f, count);
+        }
+
+        auto *out       = buffer.getWritePointer(ch, offset);
+        auto mixDelay   = [&] {
+            auto *wet = withBypassed(delayWet, out, delayFade,
+                                     scratch[kDelayDryL]);
+            crossfade(out, out, wet, delayMix, delayStep, count);
+        };
+        auto mixSprings = [&] {
+            auto *wet = withBypassed(springsWet, out, springsFade,
+                                     scratch[kSpringsDryL]);
+            crossfade(out, out, wet, springsMix, springsStep, count);
+        };
+        switch (routing) {
+        case Routing::kSerial:
+            mixDelay();
+            mixSprings();
             break;
-        case ParamId::kSpringsShape:
-            springs_.setRes(event.value, count);
+        case Routing::kSpringsDelay:
+            mixSprings();
+            mixDelay();
             break;
-        default:
+        case Routing::kParallel:
+            mixParallel(out, out,
+                        withBypassed(delayWet, out, delayFade,
+                                     scratch[kDelayDryL]),
+                        delayMix, delayStep,
+                        withBypassed(springsWet, out, springsFade,
+                                     scratch[kSpringsDryL]),
+                        springsMix, springsStep, count);
             break;
         }
     }
+}
 
-    if (useBeats_) {
-        const auto position = getPlayHead()->getPosition();
-        if (position.hasValue()) {
-            auto bpm = position->getBpm();
-            if (bpm.hasValue() && *bpm != bpm_) {
-                bpm_      = *bpm;
-                auto time = static_cast<float>(60.0 * beatsMult_ / bpm_);
-                tapedelay_.setDelay(time, count);
-            }
-
-            if (tapedelay_.getMode() != processors::TapeDelay::Mode::kNormal) {
-                if (position->getIsPlaying()) {
-                    auto ppq = position->getPpqPosition();
-                    if (ppq.hasValue()) {
-                        if (!isPlaying_) {
-                            isPlaying_ = true;
-                            nextSync_ =
-                                static_cast<double>(static_cast<int>(*ppq + 1));
-                        } else {
-                            if (nextSync_ > 0 && *ppq > nextSync_) {
-                                // today, sample accurate sync
-                                tapedelay_.setMode(tapedelay_.getMode(), count);
-                                nextSync_ = -1;
-                            }
-                        }
-                    }
-                } else if (isPlaying_) {
-                    isPlaying_ = false;
-                }
-            }
-        }
+double PluginProcessor::getBeatsMultiplier(int beat, bool dotted)
+{
+    double mult;
+    switch (beat) {
+    case kBeat132:
+        mult = 1.0 / 32.0;
+        break;
+    case kBeat116:
+        mult = 1.0 / 16.0;
+        break;
+    case kBeat18:
+        mult = 1.0 / 8.0;
+        break;
+    case kBeat16:
+        mult = 1.0 / 6.0;
+        break;
+    case kBeat14:
+        mult = 1.0 / 4.0;
+        break;
+    case kBeat13:
+        mult = 1.0 / 3.0;
+        break;
+    case kBeat12:
+        mult = 1.0 / 2.0;
+        break;
+    default:
+    case kBeat1:
+        mult = 1.0;
+        break;
+    case kBeat2:
+        mult = 2.0;
+        break;
+    case kBeat4:
+        mult = 4.0;
+        break;
+    }
+    if (dotted) {
+        mult += mult * 0.5;
     }
+    return mult;
+}
 
-    // shake springs
-    if (shake_.load()) {
-        shake_.store(false);
-        springs_.shake();
+void PluginProcessor::applyParamEvent(const ParamEvent &event, int pos,
+                                      int count, int blockCount)
+{
+    if (isSpringsParam(event.id)) {
+        if (!pipelined_) {
+            applySpringsEvent(event, pos, count, blockCount);
+        } else if (event.offset == pos) {
+            // applied and ramped by the worker when it processes this block
+            nextJob_.events[static_cast<size_t>(nextJob_.numEvents++)] = event;
+        }
+        return;
     }
 
-    const float *const *ins = buffer.getArrayOfReadPointers();
-    float *const *outs      = buffer.getArrayOfWritePointers();
+    // setters ramp over the chunk to the value at its end
+    auto value = event.getValueAt(pos + count, blockCount);
+    switch (event.id) {
+    case ParamId::kDelayActive:
+        delayBypass_.setActive(value > 0.f,
+                               getDrainSamples(ParamId::kDelayActive));
+        break;
+    case ParamId::kDelayDrywet:
+        delayMix_.set(value / 100.f, count);
+        tapedelay_.setDryWet(isWetOnly() ? 1.f : value / 100.f, count);
+        break;
+    case ParamId::kDelayTimeType:
+        useBeats_ = value > 0.f;
+        if (useBeats_) {
+            isDotted_   = value > 1.f;
+            auto *param = static_cast<juce::AudioParameterChoice *>(
+                getParameters()[static_cast<size_t>(ParamId::kDelayBeats)]);
+            value = static_cast<float>(*param);
+        } else {
+            auto *param = static_cast<juce::AudioParameterFloat *>(
+                getParameters()[static_cast<size_t>(ParamId::kDelaySeconds)]);
+            value = *param;
+        }
+    case ParamId::kDelayBeats:
+        if (useBeats_) {
+            beatsMult_ = getBeatsMultiplier(static_cast<int>(value), isDotted_);
+            auto time  = static_cast<float>(60 * beatsMult_ / bpm_);
+            tapedelay_.setDelay(time, count);
+            break;
+        } else if (event.id == ParamId::kDelayBeats) {
+            break;
+        }
+    case ParamId::kDelaySeconds:
+        if (!useBeats_) {
+            tapedelay_.setDelay(value, count);
+        }
+        break;
+    case ParamId::kDelayFeedback:
+        tapedelay_.setFeedback(value / 100.f, count);
+        break;
+    case ParamId::kDelayCutLow:
+        tapedelay_.setCutLowPass(value, count);
+        break;
+    case ParamId::kDelayCutHi:
+        tapedelay_.setCutHiPass(value, count);
+        break;
+    case ParamId::kDelaySaturation:
+        tapedelay_.setSaturation(value, count);
+        break;
+    case ParamId::kDelayDrift:
+        tapedelay_.setDrift(value / 100.f, count);
+        break;
+    case ParamId::kDelayMode:
+        tapedelay_.setMode(static_cast<decltype(tapedelay_)::Mode>(value),
+                           count);
+        break;
+    case ParamId::kRouting: {
+        routing_ = static_cast<Routing>(value);
+        delayMix_.reset(getParamValue(ParamId::kDelayDrywet) / 100.f);
+        springsMix_.reset(getParamValue(ParamId::kSpringsDryWet) / 100.f);
 
-    if (activeTapeDelay_) {
-        tapedelay_.process(ins, outs, count);
-        ins = outs;
+        // dry/wet are done by the mix stage in parallel
+        ParamEvent drywet{static_cast<int>(ParamId::kDelayDrywet),
+                          getParamValue(ParamId::kDelayDrywet), event.offset};
+        applyParamEvent(drywet, pos, count, blockCount);
+        drywet = {static_cast<int>(ParamId::kSpringsDryWet),
+                  getParamValue(ParamId::kSpringsDryWet), event.offset};
+        applyParamEvent(drywet, pos, count, blockCount);
+        break;
     }
-    if (activeSprings_) {
-        springs_.process(ins, outs, count);
-        ins = outs;
+    // springs events are sent above, engine settings change on the message
+    // thread
+    case ParamId::kSpringsActive:
+    case ParamId::kSpringsDryWet:
+    case ParamId::kSpringsWidth:
+    case ParamId::kSpringsLength:
+    case ParamId::kSpringsDecay:
+    case ParamId::kSpringsDamp:
+    case ParamId::kSpringsShape:
+    case ParamId::kSpringsTone:
+    case ParamId::kSpringsScatter:
+    case ParamId::kSpringsChaos:
+    case ParamId::kPipeline:
+    case ParamId::kInternalRate:
+    case ParamId::kOversampling:
+    case ParamId::kNumParams:
+        break;
     }
-    assert(ins == outs);
+}
 
-    // update rms buffer position
-    rmsPos_.store(static_cast<int>(*springs_.getRMSStackPos()));
+void PluginProcessor::applySpringsEvent(const ParamEvent &event, int pos,
+                                        int count, int blockCount)
+{
+    const auto value = event.getValueAt(pos + count, blockCount);
+    switch (event.id) {
+    case ParamId::kSpringsActive:
+        springsBypass_.setActive(value > 0.f,
+                                 getDrainSamples(ParamId::kSpringsActive));
+        break;
+    case ParamId::kSpringsDryWet:
+        springsMix_.set(value / 100.f, count);
+        springs_.setDryWet(isWetOnly() ? 1.f : value / 100.f, count);
+        break;
+    case ParamId::kSpringsWidth:
+        springsWidth_.set(value / 100.f, count);
+        springs_.setWidth(value / 100.f, count);
+        break;
+    case ParamId::kSpringsLength:
+        springs_.setTd(value, count);
+        break;
+    case ParamId::kSpringsDecay:
+        springs_.setT60(value, count);
+        break;
+    case ParamId::kSpringsTone:
+        springs_.setTone(value, count);
+        break;
+    case ParamId::kSpringsScatter:
+        springs_.setScatter(value / 100.f, count);
+        break;
+    case ParamId::kSpringsDamp:
+        springs_.setFreq(value, count);
+        break;
+    case ParamId::kSpringsChaos:
+        springs_.setChaos(value / 100.f, count);
+        break;
+    case ParamId::kSpringsShape:
+        springs_.setRes(value, count);
+        break;
+    // only springs events are sent here
+    case ParamId::kDelayActive:
+    case ParamId::kDelayDrywet:
+    case ParamId::kDelayTimeType:
+    case ParamId::kDelaySeconds:
+    case ParamId::kDelayBeats:
+    case ParamId::kDelayFeedback:
+    case ParamId::kDelayCutLow:
+    case ParamId::kDelayCutHi:
+    case ParamId::kDelaySaturation:
+    case ParamId::kDelayDrift:
+    case ParamId::kDelayMode:
+    case ParamId::kRouting:
+    case ParamId::kPipeline:
+    case ParamId::kInternalRate:
+    case ParamId::kOversampling:
+    case ParamId::kNumParams:
+        break;
+    }
 }
 
 //==============================================================================
@@ -394,7 +1451,18 @@ void PluginProcessor::parameterValueChanged(int id, float newValue)
     auto *ptr = static_cast<juce::RangedAudioParameter *>(getParameters()[id]);
     float value = ptr->convertFrom0to1(newValue);
 
-    paramEvents_.enqueue({id, value});
+    // the worker thread is started and the core rate changed from the
+    // message thread
+    if (static_cast<ParamId>(id) == ParamId::kPipeline ||
+        static_cast<ParamId>(id) == ParamId::kInternalRate ||
+        static_cast<ParamId>(id) == ParamId::kOversampling) {
+        triggerAsyncUpdate();
+        return;
+    }
+
+    // listener callbacks carry no sample position, they apply at the start of
+    // the next block
+    paramMailbox_.post(static_cast<size_t>(id), value);
 }
 
 void PluginProcessor::addProcessorAsListener(
@@ -2,19 +2,29 @@
 
 #include <juce_audio_processors/juce_audio_processors.h>
 
-#include "readerwriterqueue.h"
-
+#include "Arena.h"
+#include "MirroredRing.h"
+#include "Mix.h"
+#include "ParamMailbox.h"
+#include "PipelineWorker.h"
 #include "Presets/PresetManager.h"
+#include "Resampler.h"
+#include "SectionBypass.h"
 
 #include "Springs.h"
 #include "TapeDelay.h"
 
+#ifndef AETHER_BLOCK_SIZE
+#define AETHER_BLOCK_SIZE 128
+#endif
+
 namespace aether
 {
 
 //==============================================================================
 class PluginProcessor final : public juce::AudioProcessor,
-                              juce::AudioProcessorParameter::Listener
+                              juce::AudioProcessorParameter::Listener,
+                              juce::AsyncUpdater
 {
   public:
     //==============================================================================
@@ -28,7 +38,14 @@ class PluginProcessor final : public juce::AudioProcessor,
     bool isBusesLayoutSupported(const BusesLayout &layouts) const override;
 
     void processBlock(juce::AudioBuffer<float> &, juce::MidiBuffer &) override;
-    using AudioProcessor::processBlock;
+    void processBlock(juce::AudioBuffer<double> &, juce::MidiBuffer &) override;
+    void processBlockBypassed(juce::AudioBuffer<float> &,
+                              juce::MidiBuffer &) override;
+    void processBlockBypassed(juce::AudioBuffer<double> &,
+                              juce::MidiBuffer &) override;
+    // the dsp and its tails run in float, the dry path stays in double while
+    // no latency is reported
+    bool supportsDoublePrecisionProcessing() const override { return true; }
 
     //==============================================================================
     juce::AudioProcessorEditor *createEditor() override;
@@ -75,6 +92,17 @@ class PluginProcessor final : public juce::AudioProcessor,
         kSpringsTone,
         kSpringsScatter,
         kSpringsChaos,
+        kRouting,
+        kPipeline,
+        kInternalRate,
+        kOversampling,
+        kNumParams,
+    };
+
+    enum class Routing {
+        kSerial,
+        kParallel,
+        kSpringsDelay,
     };
 
     enum BeatMult {
@@ -92,12 +120,36 @@ class PluginProcessor final : public juce::AudioProcessor,
 
     struct ParamEvent {
         ParamEvent() = default;
-        ParamEvent(int tId, float tValue) :
-            id(static_cast<ParamId>(tId)), value(tValue)
+        ParamEvent(int tId, float tValue, int tOffset = 0) :
+            id(static_cast<ParamId>(tId)), value(tValue), start(tValue),
+            offset(tOffset)
         {
         }
         ParamId id{};
         float value{};
+        // continuous parameters ramp from start to value over the rest of
+        // the block
+        float start{};
+        // sample position of the change inside the next processed block.
+        // Parameter listeners carry no timestamp, host changes are always at
+        // offset 0, only the beat resync of the reverse modes lands later.
+        int offset{};
+
+        /** Value reached at sample end of a block of count samples. */
+        [[nodiscard]] float getValueAt(int end, int count) const
+        {
+            if (start == value) return value;
+            auto ratio = static_cast<float>(end - offset) /
+                         static_cast<float>(count - offset);
+            return start + (value - start) * ratio;
+        }
+
+        /** Whether the event is sent before the chunk starting at pos, where
+            it starts or to move its ramp on. */
+        [[nodiscard]] bool isDue(int pos) const
+        {
+            return offset == pos || start != value;
+        }
     };
 
     static juce::AudioProcessorValueTreeState::ParameterLayout createLayout();
@@ -124,13 +176,192 @@ class PluginProcessor final : public juce::AudioProcessor,
 
     PresetManager &getPresetManager() { return presetManager_; }
 
+    using ParamMailbox_t =
+        ParamMailbox<static_cast<size_t>(ParamId::kNumParams)>;
+    const ParamMailbox_t &getParamMailbox() const { return paramMailbox_; }
+
+    // bytes of the buffers owned by the plugin, the dsp allocates its own
+    [[nodiscard]] size_t getMemoryFootprint() const { return footprint_; }
+
   private:
+    static constexpr int kNumChannels = 2;
+    static constexpr int kMaxChannels = 8;
+    // the dsp never runs on more than kBlockSize samples at once
+    static constexpr int kBlockSize = AETHER_BLOCK_SIZE;
+    static_assert(kBlockSize > 0 && (kBlockSize & (kBlockSize - 1)) == 0,
+                  "AETHER_BLOCK_SIZE must be a power of two");
+    // one event per parameter plus the beat resyncs of the reverse modes
+    static constexpr int kMaxSyncEvents  = 4;
+    static constexpr int kMaxBlockEvents =
+        static_cast<int>(ParamId::kNumParams) + kMaxSyncEvents;
+
+    // -90dB, level under which the plugin is considered silent
+    static constexpr float kSilenceGain = 3.1623e-5f;
+    // highest rate the dsp runs at with a fixed internal rate
+    static constexpr double kMaxInternalRate = 50000.0;
+    // length of the fade when a section is switched on or off
+    static constexpr double kBypassFadeSeconds = 0.01;
+    // allpass delays of the surround rears, far from multiples of each other
+    static constexpr std::array<double, 2> kRearAllpassSeconds{0.0047, 0.0113};
+
+    static double getBeatsMultiplier(int beat, bool dotted);
+    static bool isSpringsParam(ParamId id)
+    {
+        return id >= ParamId::kSpringsActive && id <= ParamId::kSpringsChaos;
+    }
+    static bool isRampedParam(ParamId id)
+    {
+        switch (id) {
+        case ParamId::kDelayActive:
+        case ParamId::kDelayTimeType:
+        case ParamId::kDelayBeats:
+        case ParamId::kDelayMode:
+        case ParamId::kSpringsActive:
+        case ParamId::kRouting:
+        case ParamId::kPipeline:
+        case ParamId::kInternalRate:
+        case ParamId::kOversampling:
+        case ParamId::kNumParams:
+            return false;
+        case ParamId::kDelayDrywet:
+        case ParamId::kDelaySeconds:
+        case ParamId::kDelayFeedback:
+        case ParamId::kDelayCutLow:
+        case ParamId::kDelayCutHi:
+        case ParamId::kDelaySaturation:
+        case ParamId::kDelayDrift:
+        case ParamId::kSpringsDryWet:
+        case ParamId::kSpringsWidth:
+        case ParamId::kSpringsLength:
+        case ParamId::kSpringsDecay:
+        case ParamId::kSpringsDamp:
+        case ParamId::kSpringsShape:
+        case ParamId::kSpringsTone:
+        case ParamId::kSpringsScatter:
+        case ParamId::kSpringsChaos:
+            return true;
+        }
+        return false;
+    }
+    // count is the length of the chunk starting at pos, blockCount the one
+    // of the whole block
+    void applyParamEvent(const ParamEvent &event, int pos, int count,
+                         int blockCount);
+    void applySpringsEvent(const ParamEvent &event, int pos, int count,
+                           int blockCount);
+    template <typename Fn>
+    static void splitBlock(const ParamEvent *events, int numEvents, int count,
+                           Fn &&fn);
+    void process(juce::AudioBuffer<float> &buffer, bool bypassed);
+    void process(juce::AudioBuffer<double> &buffer, bool bypassed);
+    void updateTransport();
+    void processResampled(juce::AudioBuffer<float> &buffer);
+    void processCore(juce::AudioBuffer<float> &buffer);
+    void processRange(juce::AudioBuffer<float> &buffer, int offset, int count);
+    void processSurroundRange(juce::AudioBuffer<float> &buffer, int offset,
+                              int count);
+    void processParallel(float *const *io, int count);
+    void processDelay(float *const *io, int count);
+    void processSprings(float *const *io, int count);
+    template <typename Processor>
+    std::pair<float, float> runSection(SectionBypass &section,
+                                       Processor &processor, float *const *io,
+                                       float *const *dry, int count);
+    [[nodiscard]] double getDelayTimeSeconds() const;
+    [[nodiscard]] int getBeatOffset(double ppq, double beat) const;
+    [[nodiscard]] int getDrainSamples(ParamId id) const;
+    // the dsp dry/wet is left to the plugin mix stage
+    [[nodiscard]] bool isWetOnly() const
+    {
+        return surround_ || routing_.load() == Routing::kParallel;
+    }
+    [[nodiscard]] float getParamValue(ParamId id) const;
+
+    void processPipeline(juce::AudioBuffer<float> &buffer);
+    void collectSpringsJob();
+    void delayOutput(juce::AudioBuffer<float> &buffer);
+    void processSpringsJob();
+    void updatePipeline();
+    [[nodiscard]] int getCoreOctaves(double sampleRate) const;
+    void handleAsyncUpdate() override;
+
+    // placement of a surround channel relative to the stereo dsp
+    enum class SurroundRole {
+        kFrontLeft,
+        kFrontRight,
+        kCentre,
+        kLfe,
+        kRearLeft,
+        kRearRight,
+    };
+    static SurroundRole
+    getSurroundRole(juce::AudioChannelSet::ChannelType type);
+
+    enum Scratch {
+        kSendL,
+        kSendR,
+        kDelayL,
+        kDelayR,
+        kDelayCentre,
+        kSpringsL,
+        kSpringsR,
+        kSpringsCentre,
+        kRearL,
+        kRearR,
+        kRearSide,
+        kDelayDryL,
+        kDelayDryR,
+        kSpringsDryL,
+        kSpringsDryR,
+        kNumScratch,
+    };
+
     juce::AudioProcessorValueTreeState parameters_;
     PresetManager presetManager_{parameters_};
-    moodycamel::ReaderWriterQueue<ParamEvent> paramEvents_{32};
+    ParamMailbox_t paramMailbox_;
+    std::array<ParamEvent, kMaxBlockEvents> blockEvents_;
+    // last value each continuous parameter was ramped to
+    std::array<float, static_cast<size_t>(ParamId::kNumParams)> rampValues_{};
 
-    bool activeTapeDelay_{true};
-    bool activeSprings_{true};
+    std::array<float, kBlockSize> monoScratch_{};
+
+    // the audio buffers below refer to this single allocation
+    void prepareBuffers(int numChannels, int samplesPerBlock,
+                        int coreBlockSize);
+    Arena arena_;
+    std::atomic<size_t> footprint_{0};
+
+    // single precision copy of the host buffer in double precision mode
+    juce::AudioBuffer<float> floatBuffer_;
+
+    // host settings of the last prepareToPlay, the lock serialises it with
+    // the preparation done on engine changes
+    juce::CriticalSection prepareLock_;
+    bool prepared_{false};
+    double preparedSampleRate_{0.0};
+    int preparedBlockSize_{0};
+
+    // rate the dsp runs at, may differ from the host one
+    double coreSampleRate_{44100.0};
+    Resampler resampler_;
+    juce::AudioBuffer<float> coreBuffer_;
+
+    // surround and mix stage
+    bool surround_{false};
+    std::array<SurroundRole, kMaxChannels> surroundRoles_{};
+    float sendGain_{1.f};
+    juce::AudioBuffer<float> scratch_;
+    std::atomic<Routing> routing_{Routing::kSerial};
+    LinearRamp delayMix_;
+    LinearRamp springsMix_;
+    LinearRamp springsWidth_;
+    // decorrelate the side of the rears from the fronts
+    std::array<Allpass, kRearAllpassSeconds.size()> rearAllpass_;
+
+    // sections switched off keep ringing until their tail has drained
+    SectionBypass delayBypass_;
+    SectionBypass springsBypass_;
+    bool hostBypassed_{false};
 
     // atomics
     std::atomic<int> rmsPos_{0};
@@ -139,14 +370,44 @@ class PluginProcessor final : public juce::AudioProcessor,
     bool useBeats_{false};
     bool isDotted_{false};
     double beatsMult_{1};
-    double bpm_{120};
+    std::atomic<double> bpm_{120};
+    // tempo the delay time was last set for
+    double dspBpm_{120};
+
+    // silence detection
+    int64_t silentSamples_{0};
+    bool sleeping_{false};
+    float lastOutputPeak_{0.f};
 
-    // used to sync reverse delay
-    bool isPlaying_{false};
+    // used to sync reverse delay, ppq_ is the position of the next processed
+    // block while playing
+    juce::Optional<double> ppq_;
     double nextSync_{-1};
 
     processors::TapeDelay tapedelay_;
     processors::Springs springs_;
+    bool dspPrepared_{false};
+
+    // pipelined springs, the worker processes the delay output of the
+    // previous block while the audio thread runs the delay of the current one
+    struct SpringsJob {
+        std::array<ParamEvent, kMaxBlockEvents> events{};
+        int numEvents{0};
+        int count{0};
+        bool shake{false};
+    };
+    std::atomic<bool> pipelineEnabled_{false};
+    bool pipelined_{false};
+    bool delayed_{false};
+    bool jobPending_{false};
+    int pipelineLatency_{0};
+    SpringsJob nextJob_;
+    SpringsJob springsJob_;
+    juce::AudioBuffer<float> jobBuffer_;
+    // the ring reads of one block never wrap
+    MirroredRing pipelineRing_;
+    juce::AudioBuffer<float> pipelineFifo_;
+    PipelineWorker springsWorker_{[this] { processSpringsJob(); }};
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginProcessor)
@@ -93,6 +93,16 @@ void PresetManager::loadPresetFromFile(const juce::File &file)
     }
 }
 
+juce::ValueTree PresetManager::getCurrentPreset() const
+{
+    auto preset = apvts_.copyState();
+    for (int i = preset.getNumChildren(); --i >= 0;) {
+        auto id = preset.getChild(i).getProperty("id").toString();
+        if (id.startsWith(kEnginePrefix)) preset.removeChild(i, nullptr);
+    }
+    return preset;
+}
+
 void PresetManager::savePresetToFile(const juce::File &file)
 {
     std::unique_ptr<juce::XmlElement> xml(getCurrentPreset().createXml());
@@ -108,7 +118,17 @@ void PresetManager::savePresetToFile(const juce::File &file)
 void PresetManager::loadPreset(const juce::String &name,
                                const juce::ValueTree &preset)
 {
-    apvts_.state.copyPropertiesAndChildrenFrom(preset, nullptr);
+    // keep the current engine settings
+    auto merged = preset.createCopy();
+    for (const auto &child : apvts_.state) {
+        auto id = child.getProperty("id").toString();
+        if (id.startsWith(kEnginePrefix)) {
+            merged.removeChild(merged.getChildWithProperty("id", id), nullptr);
+            merged.appendChild(child.createCopy(), nullptr);
+        }
+    }
+
+    apvts_.state.copyPropertiesAndChildrenFrom(merged, nullptr);
     presetName_     = name;
     presetNotSaved_ = false;
     callListeners();
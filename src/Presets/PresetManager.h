@@ -10,6 +10,8 @@ class PresetManager : juce::ValueTree::Listener
   public:
     static constexpr auto kExtension   = "preset";
     static constexpr auto kDefaultName = "default";
+    // parameters starting with this prefix are not stored in presets
+    static constexpr auto kEnginePrefix = "engine_";
 
     using factoryPreset_t = std::tuple<const char *, const char *, size_t>;
     static constexpr auto kNFactoryPreset = 5;
@@ -56,10 +58,8 @@ class PresetManager : juce::ValueTree::Listener
     [[nodiscard]] size_t getPresetId() const { return presetId_; }
     [[nodiscard]] static juce::String getPresetName(size_t id);
 
-    [[nodiscard]] juce::ValueTree getCurrentPreset() const
-    {
-        return apvts_.copyState();
-    }
+    // the current state without the engine parameters
+    [[nodiscard]] juce::ValueTree getCurrentPreset() const;
     [[nodiscard]] auto &getPresetName() const { return presetName_; }
 
     [[nodiscard]] static auto &getFactoryPresets() { return kFactoryPresets; }
@@ -0,0 +1,275 @@
+#include "Resampler.h"
+#include "ResamplerKernels.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace aether
+{
+
+const HalfBandCoefs &getHalfBandCoefs()
+{
+    // windowed sinc, the 4 terms Blackman-Harris window keeps the stopband
+    // under -90dB
+    static const HalfBandCoefs coefs = [] {
+        constexpr auto kPi     = 3.14159265358979323846;
+        constexpr auto kTaps   = 4 * kHalfBandOrder + 3;
+        constexpr auto kCentre = (kTaps - 1) / 2;
+
+        HalfBandCoefs c{};
+        double sum = 0.0;
+        for (int i = 0; i <= kHalfBandOrder; ++i) {
+            auto offset = 2 * i + 1;
+            auto sinc   = (i % 2 == 0 ? 1.0 : -1.0) / (kPi * offset);
+            auto phase  = 2.0 * kPi * (kCentre + offset) / (kTaps - 1);
+            auto window = 0.35875 - 0.48829 * std::cos(phase) +
+                          0.14128 * std::cos(2.0 * phase) -
+                          0.01168 * std::cos(3.0 * phase);
+            c[static_cast<size_t>(i)] = static_cast<float>(sinc * window);
+            sum += sinc * window;
+        }
+
+        // unity gain at DC, both sides of the centre sum up to 0.5
+        for (auto &coef : c) {
+            coef = static_cast<float>(coef * 0.25 / sum);
+        }
+        return c;
+    }();
+    return coefs;
+}
+
+namespace kernels
+{
+const HalfBandKernels kGeneric{halfBandDown, halfBandUp};
+} // namespace kernels
+
+const HalfBandKernels &getHalfBandKernels()
+{
+    // widest instruction set supported by the cpu
+#if AETHER_DISPATCH_X86
+    if (__builtin_cpu_supports("avx512f")) return kernels::kAvx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return kernels::kAvx2;
+#endif
+    return kernels::kGeneric;
+}
+
+//==============================================================================
+void HalfBandDown::prepare(int numChannels, int maxInput, bool leadingZero)
+{
+    leadingZero_ = leadingZero;
+    numChannels_ = numChannels;
+    stride_      = kHistory + maxInput + 1;
+    kernels_     = &getHalfBandKernels();
+    buffer_.resize(static_cast<size_t>(numChannels_ * stride_));
+    reset();
+}
+
+void HalfBandDown::reset()
+{
+    // a leading zero makes outputs fall on even input samples, so that the
+    // filter delay is kLatency
+    std::fill(buffer_.begin(), buffer_.end(), 0.f);
+    pending_ = leadingZero_ ? 1 : 0;
+}
+
+int HalfBandDown::process(const float *const *in, float *const *out,
+                          int count)
+{
+    assert(kHistory + pending_ + count <= stride_);
+
+    const auto numOut   = (pending_ + count) / 2;
+    const auto leftover = pending_ + count - 2 * numOut;
+
+    for (int ch = 0; ch < numChannels_; ++ch) {
+        auto *x = buffer_.data() + ch * stride_;
+        std::copy(in[ch], in[ch] + count, x + kHistory + pending_);
+
+        // output k is centred on the sample 2k + 2 * kHalfBandOrder + 1 of
+        // the buffer
+        kernels_->down(x, out[ch], numOut);
+
+        std::copy(x + 2 * numOut, x + 2 * numOut + kHistory + leftover, x);
+    }
+
+    pending_ = leftover;
+    return numOut;
+}
+
+//==============================================================================
+void HalfBandUp::prepare(int numChannels, int maxInput)
+{
+    numChannels_ = numChannels;
+    stride_      = kHistory + maxInput;
+    kernels_     = &getHalfBandKernels();
+    buffer_.assign(static_cast<size_t>(numChannels_ * stride_), 0.f);
+}
+
+void HalfBandUp::reset() { std::fill(buffer_.begin(), buffer_.end(), 0.f); }
+
+void HalfBandUp::process(const float *const *in, float *const *out, int count)
+{
+    assert(kHistory + count <= stride_);
+
+    for (int ch = 0; ch < numChannels_; ++ch) {
+        auto *x = buffer_.data() + ch * stride_;
+        std::copy(in[ch], in[ch] + count, x + kHistory);
+        kernels_->up(x, out[ch], count);
+        std::copy(x + count, x + count + kHistory, x);
+    }
+}
+
+//==============================================================================
+void Resampler::prepare(int numChannels, int maxBlockSize, int octaves)
+{
+    assert(octaves >= -kMaxDownOctaves && octaves <= kMaxOctaves);
+    octaves_      = octaves;
+    numChannels_  = numChannels;
+    maxBlockSize_ = maxBlockSize;
+
+    // above the host rate, the first decimator goes without its leading zero
+    // when there are several, so that the round trip is a whole number of
+    // host samples
+    const auto numUpStages = std::max(octaves_, 0);
+    for (int i = 0; i < numUpStages; ++i) {
+        ups_[static_cast<size_t>(i)].prepare(numChannels, maxBlockSize << i);
+        downs_[static_cast<size_t>(i)].prepare(
+            numChannels, maxBlockSize << (i + 1), i > 0 || numUpStages == 1);
+    }
+
+    const auto numStages = std::max(-octaves_, 0);
+    for (int i = 0, size = maxBlockSize; i < numStages; ++i) {
+        downs_[static_cast<size_t>(i)].prepare(numChannels, size, true);
+        size = size / 2 + 1;
+        // the up stages may receive one sample more per stage after them
+        ups_[static_cast<size_t>(i)].prepare(numChannels, size + 2);
+    }
+
+    // above the host rate, the intermediate rate holds twice the host block.
+    // Below it, the up stages write at most one block and a few samples at
+    // each rate.
+    auto midStride  = 0;
+    auto hostStride = 0;
+    if (numUpStages > 1) {
+        midStride = maxBlockSize << (numUpStages - 1);
+    } else if (numStages > 0) {
+        midStride  = maxBlockSize / 2 + 4;
+        hostStride = maxBlockSize + 8;
+    }
+    stageBuffer_.assign(
+        static_cast<size_t>(numChannels * (midStride + hostStride)), 0.f);
+    midPtrs_.assign(static_cast<size_t>(numChannels), nullptr);
+    hostPtrs_.assign(static_cast<size_t>(numChannels), nullptr);
+    if (!stageBuffer_.empty()) {
+        for (int ch = 0; ch < numChannels; ++ch) {
+            auto *base = stageBuffer_.data() + ch * (midStride + hostStride);
+            midPtrs_[static_cast<size_t>(ch)]  = base;
+            hostPtrs_[static_cast<size_t>(ch)] = base + midStride;
+        }
+    }
+
+    fifoStride_ = numStages > 0 ? hostStride + (1 << numStages) : 0;
+    fifo_.assign(static_cast<size_t>(numChannels * fifoStride_), 0.f);
+    reset();
+}
+
+void Resampler::reset()
+{
+    for (auto &up : ups_) up.reset();
+    for (auto &down : downs_) down.reset();
+
+    std::fill(fifo_.begin(), fifo_.end(), 0.f);
+    fifoSize_ = 0;
+}
+
+int Resampler::getLatency() const
+{
+    // a pair of stages delays by twice kLatency samples at its higher rate
+    constexpr auto kPairLatency = HalfBandUp::kLatency + HalfBandDown::kLatency;
+    if (octaves_ >= 0) {
+        // counted at the core rate, less the leading zero of the first
+        // decimator when there are several
+        auto latency = 0;
+        for (int i = 0; i < octaves_; ++i) {
+            latency += kPairLatency << (octaves_ - 1 - i);
+        }
+        if (octaves_ > 1) latency -= 1 << (octaves_ - 1);
+        return latency >> octaves_;
+    }
+
+    auto latency = 0;
+    for (int i = 0; i < -octaves_; ++i) {
+        latency += kPairLatency << i;
+    }
+    return latency;
+}
+
+int Resampler::getMaxCoreSize() const
+{
+    return octaves_ >= 0 ? maxBlockSize_ << octaves_
+                         : (maxBlockSize_ >> -octaves_) + 1;
+}
+
+int Resampler::toCore(const float *const *in, float *const *core, int count)
+{
+    if (octaves_ > 0) {
+        const float *const *src = in;
+        for (int i = 0; i < octaves_; ++i) {
+            auto *const *dst = i == octaves_ - 1 ? core : midPtrs_.data();
+            ups_[static_cast<size_t>(i)].process(src, dst, count);
+            count *= 2;
+            src = dst;
+        }
+        return count;
+    }
+
+    // the first stage writes to the intermediate rate buffer
+    const float *const *src = in;
+    for (int i = 0; i < -octaves_; ++i) {
+        auto *const *dst = i == -octaves_ - 1 ? core : midPtrs_.data();
+        count            = downs_[static_cast<size_t>(i)].process(src, dst,
+                                                                  count);
+        src              = dst;
+    }
+    return count;
+}
+
+void Resampler::fromCore(const float *const *core, int coreCount,
+                         float *const *out, int count)
+{
+    if (octaves_ > 0) {
+        const float *const *src = core;
+        for (int i = octaves_ - 1; i >= 0; --i) {
+            auto *const *dst = i == 0 ? out : midPtrs_.data();
+            coreCount = downs_[static_cast<size_t>(i)].process(src, dst,
+                                                               coreCount);
+            src       = dst;
+        }
+        assert(coreCount == count);
+        (void)count;
+        return;
+    }
+
+    const float *const *src = core;
+    for (int i = -octaves_ - 1; i >= 0; --i) {
+        auto *const *dst = i == 0 ? hostPtrs_.data() : midPtrs_.data();
+        ups_[static_cast<size_t>(i)].process(src, dst, coreCount);
+        coreCount *= 2;
+        src = dst;
+    }
+
+    // the leading zero of each down stage makes the up stages produce at least
+    // the host count, the surplus waits in the fifo
+    const auto numIn = coreCount;
+    assert(fifoSize_ + numIn <= fifoStride_ && fifoSize_ + numIn >= count);
+    for (int ch = 0; ch < numChannels_; ++ch) {
+        auto *fifo = fifo_.data() + ch * fifoStride_;
+        std::copy(src[ch], src[ch] + numIn, fifo + fifoSize_);
+        std::copy(fifo, fifo + count, out[ch]);
+        std::copy(fifo + count, fifo + fifoSize_ + numIn, fifo);
+    }
+    fifoSize_ += numIn - count;
+}
+
+} // namespace aether
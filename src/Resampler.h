@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace aether
+{
+
+/** Half-band lowpass shared by the resampling stages, 4 * kHalfBandOrder + 3
+    taps of which only the centre and the odd offsets around it are non zero.
+ */
+static constexpr int kHalfBandOrder = 15;
+using HalfBandCoefs                 = std::array<float, kHalfBandOrder + 1>;
+
+/** Coefficients of the odd offsets 1, 3, 5... from the centre tap, whose
+    value is 0.5. */
+const HalfBandCoefs &getHalfBandCoefs();
+
+struct HalfBandKernels;
+/** Kernels for the widest instruction set the cpu supports. */
+const HalfBandKernels &getHalfBandKernels();
+
+/** Polyphase decimator by two. Odd input counts are accepted, the last
+    sample is kept for the next call. A leading zero makes the delay kLatency,
+    without it the delay is one input sample shorter. */
+class HalfBandDown
+{
+  public:
+    void prepare(int numChannels, int maxInput, bool leadingZero);
+    void reset();
+
+    /** Returns the number of output samples written. */
+    int process(const float *const *in, float *const *out, int count);
+
+    // delay of the filter in input samples
+    static constexpr int kLatency = 2 * kHalfBandOrder + 1;
+
+  private:
+    static constexpr int kHistory = 4 * kHalfBandOrder + 1;
+
+    const HalfBandKernels *kernels_{nullptr};
+    std::vector<float> buffer_;
+    int numChannels_{0};
+    int stride_{0};
+    int pending_{0};
+    bool leadingZero_{true};
+};
+
+/** Polyphase interpolator by two, writes twice the input count. */
+class HalfBandUp
+{
+  public:
+    void prepare(int numChannels, int maxInput);
+    void reset();
+
+    void process(const float *const *in, float *const *out, int count);
+
+    // delay of the filter in output samples
+    static constexpr int kLatency = 2 * kHalfBandOrder + 1;
+
+  private:
+    static constexpr int kHistory = 2 * kHalfBandOrder + 1;
+
+    const HalfBandKernels *kernels_{nullptr};
+    std::vector<float> buffer_;
+    int numChannels_{0};
+    int stride_{0};
+};
+
+/** Converts host blocks to the rate the dsp core runs at and back. The core
+    rate is the host rate shifted by a number of octaves, up to kMaxOctaves
+    above or kMaxDownOctaves below.
+ */
+class Resampler
+{
+  public:
+    static constexpr int kMaxOctaves     = 2;
+    static constexpr int kMaxDownOctaves = 2;
+
+    void prepare(int numChannels, int maxBlockSize, int octaves);
+    void reset();
+
+    [[nodiscard]] int getOctaves() const { return octaves_; }
+    [[nodiscard]] bool isActive() const { return octaves_ != 0; }
+    // round trip delay in host samples
+    [[nodiscard]] int getLatency() const;
+    [[nodiscard]] int getMaxBlockSize() const { return maxBlockSize_; }
+    [[nodiscard]] int getMaxCoreSize() const;
+    [[nodiscard]] int toHostSamples(int coreSamples) const
+    {
+        return octaves_ >= 0 ? coreSamples >> octaves_
+                             : coreSamples << -octaves_;
+    }
+
+    /** Writes the core rate version of count host samples, returns the number
+        of core samples. Below the host rate, the count may vary by one from
+        block to block. */
+    int toCore(const float *const *in, float *const *core, int count);
+    /** Writes count host samples from the processed core samples. */
+    void fromCore(const float *const *core, int coreCount, float *const *out,
+                  int count);
+
+  private:
+    int octaves_{0};
+    int numChannels_{0};
+    int maxBlockSize_{0};
+
+    // stage i converts between the host rate shifted by -i and -i-1 octaves,
+    // or by i and i+1 octaves above the host rate
+    static constexpr int kMaxStages = std::max(kMaxOctaves, kMaxDownOctaves);
+    std::array<HalfBandUp, kMaxStages> ups_;
+    std::array<HalfBandDown, kMaxStages> downs_;
+
+    // intermediate rate output of the stages, host rate output of the up
+    // stages below the host rate
+    std::vector<float> stageBuffer_;
+    std::vector<float *> midPtrs_;
+    std::vector<float *> hostPtrs_;
+
+    // host samples produced ahead of the reads below the host rate
+    std::vector<float> fifo_;
+    int fifoStride_{0};
+    int fifoSize_{0};
+};
+
+} // namespace aether
@@ -0,0 +1,22 @@
+// AVX-2 versions of the kernels, only called when the cpu supports them
+#include "ResamplerKernels.h"
+
+namespace aether::kernels
+{
+namespace
+{
+__attribute__((target("avx2,fma"))) void down(const float *x, float *y,
+                                              int numOut)
+{
+    halfBandDown(x, y, numOut);
+}
+
+__attribute__((target("avx2,fma"))) void up(const float *x, float *y,
+                                            int count)
+{
+    halfBandUp(x, y, count);
+}
+} // namespace
+
+const HalfBandKernels kAvx2{down, up};
+} // namespace aether::kernels
@@ -0,0 +1,22 @@
+// AVX-512 versions of the kernels, only called when the cpu supports them
+#include "ResamplerKernels.h"
+
+namespace aether::kernels
+{
+namespace
+{
+__attribute__((target("avx512f,fma"))) void down(const float *x, float *y,
+                                                 int numOut)
+{
+    halfBandDown(x, y, numOut);
+}
+
+__attribute__((target("avx512f,fma"))) void up(const float *x, float *y,
+                                               int count)
+{
+    halfBandUp(x, y, count);
+}
+} // namespace
+
+const HalfBandKernels kAvx512{down, up};
+} // namespace aether::kernels
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Resampler.h"
+
+#include <cstddef>
+
+namespace aether
+{
+
+/** Inner loops of the half-band stages. The bodies below are inlined into
+    wrappers built for each instruction set with a target attribute, one set
+    is picked at runtime. Translation units are compiled for the baseline
+    instruction set, so that no function shared between them is built for a
+    wider one.
+ */
+struct HalfBandKernels {
+    // x points to the oldest sample needed by the first output
+    void (*down)(const float *x, float *y, int numOut);
+    void (*up)(const float *x, float *y, int count);
+};
+
+namespace kernels
+{
+extern const HalfBandKernels kGeneric;
+#if AETHER_DISPATCH_X86
+extern const HalfBandKernels kAvx2;
+extern const HalfBandKernels kAvx512;
+#endif
+} // namespace kernels
+
+#if defined(__GNUC__)
+#define AETHER_KERNEL_INLINE inline __attribute__((always_inline))
+#else
+#define AETHER_KERNEL_INLINE inline
+#endif
+
+namespace
+{
+
+AETHER_KERNEL_INLINE void halfBandDown(const float *x, float *y, int numOut)
+{
+    const auto &g = getHalfBandCoefs();
+#pragma omp simd
+    for (int k = 0; k < numOut; ++k) {
+        const auto *b = x + 2 * k;
+        auto acc      = 0.5f * b[2 * kHalfBandOrder + 1];
+        for (int i = 0; i <= kHalfBandOrder; ++i) {
+            acc += g[static_cast<size_t>(i)] *
+                   (b[2 * kHalfBandOrder - 2 * i] +
+                    b[2 * kHalfBandOrder + 2 + 2 * i]);
+        }
+        y[k] = acc;
+    }
+}
+
+AETHER_KERNEL_INLINE void halfBandUp(const float *x, float *y, int count)
+{
+    const auto &g = getHalfBandCoefs();
+#pragma omp simd
+    for (int k = 0; k < count; ++k) {
+        const auto *b = x + k;
+        auto acc      = 0.f;
+        for (int i = 0; i <= kHalfBandOrder; ++i) {
+            acc += g[static_cast<size_t>(i)] *
+                   (b[kHalfBandOrder - i] + b[kHalfBandOrder + 1 + i]);
+        }
+        // even outputs are filtered, odd ones are the delayed input
+        y[2 * k]     = 2.f * acc;
+        y[2 * k + 1] = b[kHalfBandOrder + 1];
+    }
+}
+
+} // namespace
+
+} // namespace aether
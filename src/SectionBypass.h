@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <utility>
+
+namespace aether
+{
+
+/** Click free on/off switch of a processing section. Switching off fades the
+    section input out while its output keeps ringing, the section is skipped
+    once its tail has drained. Switching on fades the input back in, the dsp
+    is never reset nor reallocated so a bypassed section costs nothing.
+ */
+class SectionBypass
+{
+  public:
+    enum class State {
+        kActive,
+        kFading,
+        kDraining,
+        kBypassed,
+    };
+
+    void prepare(int fadeSamples)
+    {
+        fadeStep_ = 1.f / static_cast<float>(std::max(fadeSamples, 1));
+    }
+
+    /** Jumps to a state without fading. */
+    void reset(bool active)
+    {
+        active_       = active;
+        gain_         = active ? 1.f : 0.f;
+        state_        = active ? State::kActive : State::kBypassed;
+        quietSamples_ = 0;
+    }
+
+    /** drainSamples is the time the output must stay quiet before a section
+        switched off is considered drained. */
+    void setActive(bool active, int drainSamples)
+    {
+        if (active == active_) return;
+        active_       = active;
+        drainSamples_ = drainSamples;
+        quietSamples_ = 0;
+        state_        = State::kFading;
+    }
+
+    [[nodiscard]] bool isActive() const { return active_; }
+    [[nodiscard]] State getState() const { return state_; }
+    [[nodiscard]] bool isProcessing() const
+    {
+        return state_ != State::kBypassed;
+    }
+
+    /** Returns the input gain at the start of the next count samples and its
+        per sample step, the gain is to be clamped to [0, 1]. */
+    std::pair<float, float> advance(int count)
+    {
+        if (state_ != State::kFading) return {gain_, 0.f};
+
+        const auto start = gain_;
+        const auto step  = active_ ? fadeStep_ : -fadeStep_;
+        gain_ = std::clamp(gain_ + step * static_cast<float>(count), 0.f, 1.f);
+        if (gain_ == (active_ ? 1.f : 0.f)) {
+            state_ = active_ ? State::kActive : State::kDraining;
+        }
+        return {start, step};
+    }
+
+    /** Reports whether the output of a draining section stayed under the
+        silence threshold during the last count samples. */
+    void drain(bool quiet, int count)
+    {
+        if (state_ != State::kDraining) return;
+        quietSamples_ = quiet ? quietSamples_ + count : 0;
+        if (quietSamples_ > drainSamples_) state_ = State::kBypassed;
+    }
+
+  private:
+    State state_{State::kActive};
+    bool active_{true};
+    float gain_{1.f};
+    float fadeStep_{1.f};
+    int drainSamples_{0};
+    int quietSamples_{0};
+};
+
+} // namespace aether
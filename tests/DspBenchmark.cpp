@@ -0,0 +1,396 @@
+#include "Resampler.h"
+#include "Springs.h"
+#include "TapeDelay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+using namespace aether;
+
+constexpr float kSampleRate = 48000.f;
+constexpr int kNumChannels  = 2;
+// the chunk size of the plugin
+constexpr int kBlockSize = AETHER_BLOCK_SIZE;
+// ten seconds of audio for each measure
+constexpr int kLength = 480000;
+
+/** The tape delay followed by the springs, as in the serial routing. */
+class Dsp
+{
+  public:
+    explicit Dsp(int blockSize)
+    {
+        tapedelay_.prepare(kSampleRate, blockSize);
+        springs_.prepare(kSampleRate, blockSize);
+    }
+
+    ~Dsp()
+    {
+        tapedelay_.free();
+        springs_.free();
+    }
+
+    void process(float *const *io, int count)
+    {
+        // echoes keep the delay line and the saturation busy, each setter
+        // is followed by one process call of the same length
+        if (first_) {
+            tapedelay_.setDelay(0.3f, count);
+            tapedelay_.setFeedback(0.6f, count);
+            first_ = false;
+        }
+        tapedelay_.process(io, io, count);
+        springs_.process(io, io, count);
+    }
+
+  private:
+    processors::TapeDelay tapedelay_;
+    processors::Springs springs_;
+    bool first_{true};
+};
+
+std::vector<float> makeNoise(size_t size)
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-0.1f, 0.1f);
+    std::vector<float> noise(size);
+    for (auto &v : noise) v = dist(rng);
+    return noise;
+}
+
+// nanoseconds per sample frame for host blocks of hostSize samples, cut in
+// chunks of at most chunkSize samples
+double runDsp(int hostSize, int chunkSize)
+{
+    // the processors hold their delay lines, too large for the stack
+    auto dsp         = std::make_unique<Dsp>(chunkSize);
+    const auto noise = makeNoise(static_cast<size_t>(kNumChannels * hostSize));
+    std::vector<float> buffer(noise.size());
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int pos = 0; pos < kLength; pos += hostSize) {
+        std::copy(noise.begin(), noise.end(), buffer.begin());
+        for (int offset = 0; offset < hostSize; offset += chunkSize) {
+            float *io[kNumChannels] = {buffer.data() + offset,
+                                       buffer.data() + hostSize + offset};
+            dsp->process(io, std::min(chunkSize, hostSize - offset));
+        }
+    }
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() / kLength;
+}
+
+// the dsp prepared for and run on whole host blocks, then in chunks of
+// kBlockSize samples
+void benchmarkChunking()
+{
+    std::printf("host block   whole block   %d sample chunks\n", kBlockSize);
+    for (int hostSize = 16; hostSize <= 8192; hostSize *= 2) {
+        const auto whole   = runDsp(hostSize, hostSize);
+        const auto chunked = runDsp(hostSize, std::min(hostSize, kBlockSize));
+        std::printf("%10d %10.1fns %14.1fns\n", hostSize, whole, chunked);
+    }
+}
+
+// nanoseconds per sample frame for each bus layout, with host blocks of 512
+// samples. The processors are stereo only, mono is run as in processRange.
+void benchmarkLayouts()
+{
+    constexpr int kHostSize = 512;
+    struct Layout {
+        const char *name;
+        int numInputs;
+        int numOutputs;
+    };
+    const Layout layouts[] = {{"stereo -> stereo", 2, 2},
+                              {"mono -> stereo", 1, 2},
+                              {"mono -> mono", 1, 1}};
+
+    for (const auto &layout : layouts) {
+        auto dsp         = std::make_unique<Dsp>(kBlockSize);
+        const auto noise = makeNoise(static_cast<size_t>(kHostSize));
+        std::vector<float> buffer(
+            static_cast<size_t>(layout.numOutputs * kHostSize));
+        std::vector<float> monoScratch(kBlockSize);
+        const bool mono = layout.numOutputs == 1;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int pos = 0; pos < kLength; pos += kHostSize) {
+            for (int ch = 0; ch < layout.numInputs; ++ch) {
+                std::copy(noise.begin(), noise.end(),
+                          buffer.begin() + ch * kHostSize);
+            }
+            // mono -> stereo, both dsp channels start from the mono input
+            if (layout.numInputs == 1 && layout.numOutputs > 1) {
+                std::copy(noise.begin(), noise.end(),
+                          buffer.begin() + kHostSize);
+            }
+            for (int offset = 0; offset < kHostSize; offset += kBlockSize) {
+                const auto n = std::min(kBlockSize, kHostSize - offset);
+                float *io[kNumChannels];
+                io[0] = buffer.data() + offset;
+                if (mono) {
+                    io[1] = monoScratch.data();
+                    std::copy(io[0], io[0] + n, io[1]);
+                } else {
+                    io[1] = buffer.data() + kHostSize + offset;
+                }
+                dsp->process(io, n);
+                if (mono) {
+                    for (int i = 0; i < n; ++i) {
+                        io[0][i] = 0.5f * (io[0][i] + io[1][i]);
+                    }
+                }
+            }
+        }
+        const std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+        std::printf("%-18s %6.1fns\n", layout.name,
+                    elapsed.count() / kLength);
+    }
+}
+
+// nanoseconds per sample frame for a double host buffer, converted to float
+// and back around the dsp, or with only the difference the dsp adds going
+// through float as in the double processBlock
+void benchmarkDouble()
+{
+    constexpr int kHostSize = 512;
+    const char *names[]     = {"converted float", "double"};
+
+    for (int path = 0; path < 2; ++path) {
+        auto dsp         = std::make_unique<Dsp>(kBlockSize);
+        const auto noise = makeNoise(static_cast<size_t>(kNumChannels *
+                                                         kHostSize));
+        std::vector<double> host(noise.size());
+        std::vector<float> buffer(noise.size());
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int pos = 0; pos < kLength; pos += kHostSize) {
+            std::copy(noise.begin(), noise.end(), host.begin());
+            for (size_t i = 0; i < host.size(); ++i) {
+                buffer[i] = static_cast<float>(host[i]);
+            }
+            for (int offset = 0; offset < kHostSize; offset += kBlockSize) {
+                float *io[kNumChannels] = {buffer.data() + offset,
+                                           buffer.data() + kHostSize + offset};
+                dsp->process(io, std::min(kBlockSize, kHostSize - offset));
+            }
+            for (size_t i = 0; i < host.size(); ++i) {
+                if (path == 0) {
+                    host[i] = static_cast<double>(buffer[i]);
+                } else {
+                    auto dry = static_cast<float>(host[i]);
+                    host[i] += static_cast<double>(buffer[i] - dry);
+                }
+            }
+        }
+        const std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+        std::printf("%-16s %6.1fns\n", names[path],
+                    elapsed.count() / kLength);
+    }
+}
+
+// the test tone completes a whole number of periods in the analysis window,
+// its harmonics and their aliases fall on separate bins
+constexpr int kAnalysisLength = 4096;
+constexpr int kToneBin        = 437;
+// the highest delay_saturation, in dB
+constexpr float kMaxDrive = 15.f;
+
+/** The dsp core at the rate of an engine_oversampling choice, behind the
+    resampler as in processCore. The tape delay runs wet only without
+    feedback or drift, so that its output is the saturated tone. */
+class OversampledCore
+{
+  public:
+    static constexpr int kHostSize = 512;
+
+    OversampledCore(int octaves, bool withSprings) :
+        octaves_(octaves), withSprings_(withSprings)
+    {
+        if (octaves_ > 0) {
+            resampler_.prepare(kNumChannels, kHostSize, octaves_);
+            coreStride_ = resampler_.getMaxCoreSize();
+            core_.resize(static_cast<size_t>(kNumChannels * coreStride_));
+        }
+
+        const auto sampleRate = std::ldexp(kSampleRate, octaves_);
+        tapedelay_.prepare(sampleRate, kBlockSize);
+        springs_.prepare(sampleRate, kBlockSize);
+    }
+
+    ~OversampledCore()
+    {
+        tapedelay_.free();
+        springs_.free();
+    }
+
+    void process(float *const *io, int count)
+    {
+        float *core[kNumChannels];
+        auto coreCount = count;
+        for (int ch = 0; ch < kNumChannels; ++ch) {
+            core[ch] = octaves_ > 0 ? core_.data() + ch * coreStride_ : io[ch];
+        }
+        if (octaves_ > 0) coreCount = resampler_.toCore(io, core, count);
+
+        for (int offset = 0; offset < coreCount; offset += kBlockSize) {
+            const auto n = std::min(kBlockSize, coreCount - offset);
+            float *chunk[kNumChannels] = {core[0] + offset, core[1] + offset};
+            if (first_) {
+                tapedelay_.setDryWet(1.f, n);
+                tapedelay_.setFeedback(0.f, n);
+                tapedelay_.setDrift(0.f, n);
+                tapedelay_.setSaturation(kMaxDrive, n);
+                first_ = false;
+            }
+            tapedelay_.process(chunk, chunk, n);
+            if (withSprings_) springs_.process(chunk, chunk, n);
+        }
+
+        if (octaves_ > 0) resampler_.fromCore(core, coreCount, io, count);
+    }
+
+  private:
+    int octaves_;
+    bool withSprings_;
+    bool first_{true};
+    Resampler resampler_;
+    std::vector<float> core_;
+    int coreStride_{0};
+    processors::TapeDelay tapedelay_;
+    processors::Springs springs_;
+};
+
+// one analysis window of the tone, repeated by runTone
+const std::vector<float> &getTone()
+{
+    static const std::vector<float> tone = [] {
+        constexpr auto kPi = 3.14159265358979323846;
+        std::vector<float> t(kAnalysisLength);
+        for (int i = 0; i < kAnalysisLength; ++i) {
+            t[static_cast<size_t>(i)] = static_cast<float>(
+                0.5 * std::sin(2.0 * kPi * kToneBin * i / kAnalysisLength));
+        }
+        return t;
+    }();
+    return tone;
+}
+
+void runTone(OversampledCore &core, std::vector<float> &out, int length)
+{
+    constexpr auto kHostSize = OversampledCore::kHostSize;
+    const auto &tone         = getTone();
+    std::vector<float> buffer(static_cast<size_t>(kNumChannels * kHostSize));
+    float *io[kNumChannels] = {buffer.data(), buffer.data() + kHostSize};
+
+    out.resize(static_cast<size_t>(length));
+    for (int pos = 0; pos < length; pos += kHostSize) {
+        const auto n = std::min(kHostSize, length - pos);
+        for (int i = 0; i < n; ++i) {
+            const auto x = tone[static_cast<size_t>((pos + i) %
+                                                    kAnalysisLength)];
+            for (auto *ch : io) ch[i] = x;
+        }
+        core.process(io, n);
+        std::copy(io[0], io[0] + n, out.begin() + pos);
+    }
+}
+
+// power of everything but the harmonics of the tone up to 20kHz, relative to
+// the tone. Above, the transition band of the half-band filters lets through
+// the harmonics closest to the host Nyquist frequency.
+double getAliasingDb(const float *x)
+{
+    constexpr auto N       = kAnalysisLength;
+    constexpr auto kPi     = 3.14159265358979323846;
+    constexpr auto kMaxBin = static_cast<int>(20000.0 * N / kSampleRate);
+    std::vector<double> cosTable(N);
+    std::vector<double> sinTable(N);
+    for (int n = 0; n < N; ++n) {
+        cosTable[static_cast<size_t>(n)] = std::cos(2.0 * kPi * n / N);
+        sinTable[static_cast<size_t>(n)] = std::sin(2.0 * kPi * n / N);
+    }
+
+    double tone     = 0.0;
+    double aliasing = 0.0;
+    for (int k = 1; k <= kMaxBin; ++k) {
+        double re = 0.0;
+        double im = 0.0;
+        for (int n = 0; n < N; ++n) {
+            const auto index = static_cast<size_t>((k * n) % N);
+            re += static_cast<double>(x[n]) * cosTable[index];
+            im -= static_cast<double>(x[n]) * sinTable[index];
+        }
+        const auto power = re * re + im * im;
+        if (k == kToneBin) {
+            tone = power;
+        } else if (k % kToneBin != 0) {
+            aliasing += power;
+        }
+    }
+    return 10.0 * std::log10(aliasing / tone);
+}
+
+// aliasing of the tape saturation at +15dB on a 5kHz tone, and cpu load of
+// the whole core, for each engine_oversampling choice at 48kHz
+void benchmarkOversampling()
+{
+    const char *names[] = {"Off", "2x", "4x"};
+    for (int octaves = 0; octaves <= Resampler::kMaxOctaves; ++octaves) {
+        // the analysis window starts once the delay and filters are settled
+        auto tapeOnly = std::make_unique<OversampledCore>(octaves, false);
+        std::vector<float> out;
+        runTone(*tapeOnly, out, 16 * kAnalysisLength);
+        const auto aliasing =
+            getAliasingDb(out.data() + out.size() - kAnalysisLength);
+
+        auto core = std::make_unique<OversampledCore>(octaves, true);
+        getTone(); // built before the timing
+        const auto start = std::chrono::steady_clock::now();
+        runTone(*core, out, kLength);
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        const auto load = 100.0 * elapsed.count() * kSampleRate / kLength;
+
+        std::printf("oversampling %s: aliasing %.1fdB, cpu %.2f%%\n",
+                    names[octaves], aliasing, load);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const std::string benchmark = argc > 1 ? argv[1] : "";
+    if (benchmark == "chunking") {
+        benchmarkChunking();
+        return 0;
+    }
+    if (benchmark == "layouts") {
+        benchmarkLayouts();
+        return 0;
+    }
+    if (benchmark == "double") {
+        benchmarkDouble();
+        return 0;
+    }
+    if (benchmark == "oversampling") {
+        benchmarkOversampling();
+        return 0;
+    }
+
+    std::fprintf(stderr, "unknown benchmark '%s'\n", benchmark.c_str());
+    return 1;
+}
@@ -0,0 +1,120 @@
+#include "MirroredRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+using namespace aether;
+
+constexpr int kSampleRate = 48000;
+// samples written and read at once, a dsp chunk
+constexpr int kBlockSize = 128;
+constexpr int kNumBlocks = 40000;
+
+/** The fifo MirroredRing replaced, its position wraps on every sample. */
+class WrappingRing
+{
+  public:
+    void prepare(int size)
+    {
+        buffer_.assign(static_cast<size_t>(size), 0.f);
+        pos_ = 0;
+    }
+
+    void write(const float *in, int count)
+    {
+        const auto size = static_cast<int>(buffer_.size());
+        for (int i = 0; i < count; ++i) {
+            buffer_[static_cast<size_t>(pos_)] = in[i];
+            if (++pos_ == size) pos_ = 0;
+        }
+    }
+
+    void read(float *out, int delay, int count) const
+    {
+        const auto size = static_cast<int>(buffer_.size());
+        auto pos        = (pos_ - delay + size) % size;
+        for (int i = 0; i < count; ++i) {
+            out[i] = buffer_[static_cast<size_t>(pos)];
+            if (++pos == size) pos = 0;
+        }
+    }
+
+  private:
+    std::vector<float> buffer_;
+    int pos_{0};
+};
+
+// a ramp that never repeats within the ring, so a read at the wrong position
+// shows up
+void fillBlock(float *block, int index)
+{
+    for (int i = 0; i < kBlockSize; ++i) {
+        block[i] = static_cast<float>((index * kBlockSize + i) % 65536);
+    }
+}
+
+// the delay moves by a sample from block to block, reads start at every
+// offset of the ring
+int getDelay(int size, int index) { return size - index % kBlockSize; }
+
+template <typename Fn>
+double timeBlocks(std::vector<float> &out, Fn &&processBlock)
+{
+    std::vector<float> in(kBlockSize);
+    out.resize(static_cast<size_t>(kNumBlocks * kBlockSize));
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int b = 0; b < kNumBlocks; ++b) {
+        fillBlock(in.data(), b);
+        processBlock(in.data(), out.data() + b * kBlockSize, b);
+    }
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (kNumBlocks * kBlockSize);
+}
+
+} // namespace
+
+int main()
+{
+    // delay lines from 10ms to 10s at 48kHz
+    const int sizes[] = {kSampleRate / 100, kSampleRate / 10, kSampleRate,
+                         kSampleRate * 10};
+
+    bool passed = true;
+    std::printf("ring size   wrapping   mirrored\n");
+    for (auto size : sizes) {
+        WrappingRing wrapping;
+        wrapping.prepare(size);
+        std::vector<float> wrappingOut;
+        const auto wrappingTime = timeBlocks(
+            wrappingOut, [&](const float *in, float *out, int b) {
+                wrapping.write(in, kBlockSize);
+                wrapping.read(out, getDelay(size, b), kBlockSize);
+            });
+
+        MirroredRing mirrored;
+        mirrored.prepare(size, kBlockSize);
+        std::vector<float> storage(
+            static_cast<size_t>(mirrored.getStorageSize()), 0.f);
+        std::vector<float> mirroredOut;
+        const auto mirroredTime = timeBlocks(
+            mirroredOut, [&](const float *in, float *out, int b) {
+                mirrored.write(storage.data(), in, kBlockSize);
+                mirrored.advance(kBlockSize);
+                const auto *read =
+                    mirrored.read(storage.data(), getDelay(size, b));
+                std::copy(read, read + kBlockSize, out);
+            });
+
+        const auto same = wrappingOut == mirroredOut;
+        std::printf("%9d %8.2fns %8.2fns%s\n", size, wrappingTime,
+                    mirroredTime, same ? "" : "  outputs differ");
+        passed = passed && same;
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+#include "Resampler.h"
+#include "ResamplerKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+using namespace aether;
+
+std::vector<float> makeNoise(size_t size)
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+    std::vector<float> noise(size);
+    for (auto &v : noise) v = dist(rng);
+    return noise;
+}
+
+float getMaxDifference(const std::vector<float> &a, const std::vector<float> &b)
+{
+    float diff = 0.f;
+    for (size_t i = 0; i < a.size(); ++i) {
+        diff = std::max(diff, std::abs(a[i] - b[i]));
+    }
+    return diff;
+}
+
+// every kernel set gives the output of the generic one, up to the rounding
+// of fused multiply-adds
+bool testKernels()
+{
+    constexpr int kCount       = 1000;
+    constexpr float kTolerance = 1e-5f;
+    const auto x = makeNoise(2 * kCount + 4 * kHalfBandOrder + 4);
+
+    struct Variant {
+        const char *name;
+        const HalfBandKernels *kernels;
+        bool supported;
+    };
+    std::vector<Variant> variants{{"generic", &kernels::kGeneric, true}};
+#if AETHER_DISPATCH_X86
+    variants.push_back({"avx2", &kernels::kAvx2,
+                        __builtin_cpu_supports("avx2") != 0 &&
+                            __builtin_cpu_supports("fma") != 0});
+    variants.push_back(
+        {"avx512", &kernels::kAvx512, __builtin_cpu_supports("avx512f") != 0});
+#endif
+
+    std::vector<float> refDown(kCount);
+    std::vector<float> refUp(2 * kCount);
+    kernels::kGeneric.down(x.data(), refDown.data(), kCount);
+    kernels::kGeneric.up(x.data(), refUp.data(), kCount);
+
+    bool passed = true;
+    for (const auto &variant : variants) {
+        if (!variant.supported) {
+            std::printf("%s: not supported by this cpu, skipped\n",
+                        variant.name);
+            continue;
+        }
+        std::vector<float> down(kCount);
+        std::vector<float> up(2 * kCount);
+        variant.kernels->down(x.data(), down.data(), kCount);
+        variant.kernels->up(x.data(), up.data(), kCount);
+
+        const auto diff = std::max(getMaxDifference(down, refDown),
+                                   getMaxDifference(up, refUp));
+        std::printf("%s: max difference %g\n", variant.name, diff);
+        passed = passed && diff <= kTolerance;
+    }
+    return passed;
+}
+
+// an impulse sent to the core rate and back peaks at the reported latency,
+// for every core rate and with host blocks of any size. The host rate is not
+// resampled.
+bool testLatency()
+{
+    constexpr int kMaxBlock = 64;
+    constexpr int kLength   = 1024;
+
+    bool passed = true;
+    for (int octaves = -Resampler::kMaxDownOctaves;
+         octaves <= Resampler::kMaxOctaves; ++octaves) {
+        if (octaves == 0) continue;
+
+        Resampler resampler;
+        resampler.prepare(1, kMaxBlock, octaves);
+
+        std::vector<float> in(kLength, 0.f);
+        std::vector<float> out(kLength, 0.f);
+        std::vector<float> core(
+            static_cast<size_t>(resampler.getMaxCoreSize()));
+        in[0] = 1.f;
+
+        for (int pos = 0, n = 0; pos < kLength; pos += n) {
+            n               = std::min(kLength - pos, 1 + pos % kMaxBlock);
+            const float *x  = in.data() + pos;
+            float *y        = out.data() + pos;
+            float *c        = core.data();
+            const auto size = resampler.toCore(&x, &c, n);
+            resampler.fromCore(&c, size, &y, n);
+        }
+
+        const auto peak = std::max_element(out.begin(), out.end(),
+                                           [](float a, float b) {
+                                               return std::abs(a) <
+                                                      std::abs(b);
+                                           }) -
+                          out.begin();
+        std::printf("octaves %d: latency %d, peak at %d\n", octaves,
+                    resampler.getLatency(), static_cast<int>(peak));
+        passed = passed && peak == resampler.getLatency();
+    }
+    return passed;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const std::string test = argc > 1 ? argv[1] : "";
+    if (test == "kernels") return testKernels() ? 0 : 1;
+    if (test == "latency") return testLatency() ? 0 : 1;
+
+    std::fprintf(stderr, "unknown test '%s'\n", test.c_str());
+    return 1;
+}